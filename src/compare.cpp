@@ -0,0 +1,657 @@
+#include <cmath>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "libplacebo_render.h"
+#include "mapping.h"
+#include "params.h"
+
+namespace
+{
+    inline const char* avs_pool_str(AVS_ScriptEnvironment* env, std::string_view s)
+    {
+        return g_avs_api->avs_save_string(env, s.data(), static_cast<int>(s.size()));
+    }
+
+    inline AVS_Value avs_err_val(AVS_ScriptEnvironment* env, std::string_view s)
+    {
+        return avs_new_value_error(avs_pool_str(env, s));
+    }
+
+    // SSIM window of Wang et al.: 11x11 Gaussian, sigma 1.5.
+    inline constexpr int ssim_radius{5};
+    inline constexpr double ssim_sigma{1.5};
+
+    // MS-SSIM scale weights of Wang et al.
+    inline constexpr std::array<double, 5> ms_ssim_weights{0.0448, 0.2856, 0.3001, 0.2363, 0.1333};
+
+    // A zero mean squared error is reported as this PSNR.
+    inline constexpr double psnr_max{100.0};
+
+    enum class compare_space
+    {
+        native,
+        linear,
+        pq,
+    };
+
+    struct plane_scores
+    {
+        double psnr;
+        double ssim;
+        double ms_ssim; // NaN if the plane is too small for 5 scales
+    };
+
+    struct compare_context
+    {
+        std::mutex mtx;
+        std::shared_ptr<priv> vf;
+        avs_helpers::avs_clip_ptr ref;
+        int ref_num_frames;
+
+        int num_src_planes;
+        std::array<plane_upload, 4> layout;
+        bool is_rgb;
+
+        compare_space space;
+        bool ms_ssim;
+        int num_planes;                    // compared planes (RGB channels in linear / PQ space)
+        std::array<const char*, 4> names;  // suffixes of the frame props
+        float value_scale;                 // normalizes the coded values to [0, 1] in native space
+
+        pl_frame src_frame;
+        pl_render_params render_params;
+        pl_fmt stat_fmt;
+        pl_fmt gray_fmt;
+
+        std::array<std::array<pl_tex, 4>, 2> uploads{};
+        std::array<pl_tex, 2> rgb{};
+        // [clip][plane][scale], MS-SSIM downsampled planes (scale 0 is the source).
+        std::array<std::array<std::array<pl_tex, 5>, 4>, 2> scales{};
+        // [plane][scale], per-pixel SSIM terms summed down to 1x1.
+        std::array<std::array<std::vector<pl_tex>, 5>, 4> stats;
+
+        std::ofstream log;
+        std::vector<bool> logged;
+        std::array<std::array<double, 3>, 4> log_sums{};
+        std::array<int, 4> log_ms_count{};
+        int log_frames{};
+
+        ~compare_context()
+        {
+            if (log.is_open() && log_frames)
+            {
+                for (int i{0}; i < num_planes; ++i)
+                {
+                    const auto& sums{log_sums[i]};
+                    log << std::format("# mean,{},{:.6f},{:.6f},", names[i], sums[0] / log_frames, sums[1] / log_frames);
+                    if (log_ms_count[i])
+                        log << std::format("{:.6f}", sums[2] / log_ms_count[i]);
+                    log << '\n';
+                }
+            }
+
+            if (!vf || !vf->vk)
+                return;
+
+            const auto& gpu{vf->vk->gpu};
+            for (auto& clip_tex : uploads)
+            {
+                for (auto& tex : clip_tex)
+                    pl_tex_destroy(gpu, &tex);
+            }
+            for (auto& tex : rgb)
+                pl_tex_destroy(gpu, &tex);
+            for (auto& clip_tex : scales)
+            {
+                for (auto& plane_tex : clip_tex)
+                {
+                    for (auto& tex : plane_tex)
+                        pl_tex_destroy(gpu, &tex);
+                }
+            }
+            for (auto& plane_chains : stats)
+            {
+                for (auto& chain : plane_chains)
+                {
+                    for (auto& tex : chain)
+                        pl_tex_destroy(gpu, &tex);
+                }
+            }
+        }
+    };
+
+    std::string ssim_window()
+    {
+        std::array<double, ssim_radius + 1> w;
+        double sum{};
+        for (int i{0}; i <= ssim_radius; ++i)
+        {
+            w[i] = std::exp(-(i * i) / (2.0 * ssim_sigma * ssim_sigma));
+            sum += (i) ? 2.0 * w[i] : w[i];
+        }
+
+        std::string out{std::format("const float w[{}] = float[{}](", ssim_radius + 1, ssim_radius + 1)};
+        for (int i{0}; i <= ssim_radius; ++i)
+            out += std::format("{}{:.9f}", (i) ? ", " : "", w[i] / sum);
+        out += ");";
+        return out;
+    }
+
+    bool dispatch_custom(const priv& vf, const char* description, const std::string& body, std::span<const pl_shader_desc> descs,
+        pl_tex target) noexcept
+    {
+        pl_shader sh{pl_dispatch_begin(vf.dp.get())};
+        const pl_custom_shader custom{
+            .description = description,
+            .body = body.c_str(),
+            .output = PL_SHADER_SIG_COLOR,
+            .descriptors = descs.data(),
+            .num_descriptors = static_cast<int>(descs.size()),
+        };
+
+        if (!pl_shader_custom(sh, &custom))
+        {
+            pl_dispatch_abort(vf.dp.get(), &sh);
+            return false;
+        }
+
+        const pl_dispatch_params params{
+            .shader = &sh,
+            .target = target,
+        };
+
+        return pl_dispatch_finish(vf.dp.get(), &params);
+    }
+
+    pl_shader_desc sampled(const char* name, pl_tex tex) noexcept
+    {
+        return {.desc = {.name = name, .type = PL_DESC_SAMPLED_TEX}, .binding = {.object = tex}};
+    }
+
+    // Mean SSIM, mean contrast-structure term and mean squared error of channel `ch` of a and b.
+    // The per-pixel terms are summed in 4x4 blocks on the GPU, so only one texel is read back.
+    std::optional<std::array<double, 3>> plane_stats(
+        compare_context* d, pl_tex a, pl_tex b, int ch, float scale, std::vector<pl_tex>& chain) noexcept
+    {
+        const auto& vf{*d->vf};
+        const auto& gpu{vf.vk->gpu};
+        const int w{a->params.w};
+        const int h{a->params.h};
+
+        {
+            int lw{w};
+            int lh{h};
+            size_t i{0};
+            while (true)
+            {
+                if (chain.size() <= i)
+                    chain.emplace_back();
+
+                const pl_tex_params t{
+                    .w = lw,
+                    .h = lh,
+                    .format = d->stat_fmt,
+                    .sampleable = true,
+                    .renderable = true,
+                    .host_readable = true,
+                };
+                if (!pl_tex_recreate(gpu, &chain[i], &t))
+                    return std::nullopt;
+
+                ++i;
+                if (lw == 1 && lh == 1)
+                    break;
+
+                lw = (lw + 3) / 4;
+                lh = (lh + 3) / 4;
+            }
+
+            while (chain.size() > i)
+            {
+                pl_tex_destroy(gpu, &chain.back());
+                chain.pop_back();
+            }
+        }
+
+        const std::array descs{sampled("ta", a), sampled("tb", b)};
+        const std::string body{std::format(R"({}
+ivec2 p = ivec2(gl_FragCoord.xy);
+ivec2 lim = textureSize(ta, 0) - 1;
+float ma = 0.0, mb = 0.0, saa = 0.0, sbb = 0.0, sab = 0.0;
+for (int y = -{}; y <= {}; y++) {{
+    for (int x = -{}; x <= {}; x++) {{
+        float k = w[abs(x)] * w[abs(y)];
+        ivec2 q = clamp(p + ivec2(x, y), ivec2(0), lim);
+        float va = texelFetch(ta, q, 0)[{}] * {:.9f};
+        float vb = texelFetch(tb, q, 0)[{}] * {:.9f};
+        ma += k * va;
+        mb += k * vb;
+        saa += k * va * va;
+        sbb += k * vb * vb;
+        sab += k * va * vb;
+    }}
+}}
+saa -= ma * ma;
+sbb -= mb * mb;
+sab -= ma * mb;
+float cs = (2.0 * sab + 9e-4) / (saa + sbb + 9e-4);
+float l = (2.0 * ma * mb + 1e-4) / (ma * ma + mb * mb + 1e-4);
+float e = (texelFetch(ta, p, 0)[{}] - texelFetch(tb, p, 0)[{}]) * {:.9f};
+color = vec4(l * cs, cs, e * e, 0.0);)",
+            ssim_window(), ssim_radius, ssim_radius, ssim_radius, ssim_radius, ch, scale, ch, scale, ch, ch, scale)};
+
+        if (!dispatch_custom(vf, "SSIM", body, descs, chain[0]))
+            return std::nullopt;
+
+        static constexpr std::string_view reduce_body{R"(ivec2 p = ivec2(gl_FragCoord.xy) * 4;
+ivec2 sz = textureSize(t, 0);
+vec4 s = vec4(0.0);
+for (int y = 0; y < 4; y++) {
+    for (int x = 0; x < 4; x++) {
+        ivec2 q = p + ivec2(x, y);
+        if (q.x < sz.x && q.y < sz.y)
+            s += texelFetch(t, q, 0);
+    }
+}
+color = s;)"};
+
+        for (size_t i{1}; i < chain.size(); ++i)
+        {
+            const std::array reduce_descs{sampled("t", chain[i - 1])};
+            if (!dispatch_custom(vf, "SSIM sum", std::string{reduce_body}, reduce_descs, chain[i]))
+                return std::nullopt;
+        }
+
+        std::array<float, 4> sums{};
+        const pl_tex_transfer_params ttr{
+            .tex = chain.back(),
+            .ptr = sums.data(),
+        };
+
+        if (!pl_tex_download(gpu, &ttr))
+            return std::nullopt;
+
+        const double count{static_cast<double>(w) * h};
+        return std::array{sums[0] / count, sums[1] / count, sums[2] / count};
+    }
+
+    // 2x2 box filter and decimation of channel `ch` of src (one MS-SSIM scale).
+    bool downsample(compare_context* d, pl_tex src, int ch, float scale, pl_tex& dst) noexcept
+    {
+        const auto& vf{*d->vf};
+        const pl_tex_params t{
+            .w = src->params.w / 2,
+            .h = src->params.h / 2,
+            .format = d->gray_fmt,
+            .sampleable = true,
+            .renderable = true,
+        };
+        if (!pl_tex_recreate(vf.vk->gpu, &dst, &t))
+            return false;
+
+        const std::array descs{sampled("t", src)};
+        const std::string body{std::format(R"(ivec2 p = ivec2(gl_FragCoord.xy) * 2;
+float s = texelFetch(t, p, 0)[{}] + texelFetch(t, p + ivec2(1, 0), 0)[{}] +
+          texelFetch(t, p + ivec2(0, 1), 0)[{}] + texelFetch(t, p + ivec2(1, 1), 0)[{}];
+color = vec4(s * {:.9f});)",
+            ch, ch, ch, ch, scale * 0.25f)};
+
+        return dispatch_custom(vf, "MS-SSIM downsample", body, descs, dst);
+    }
+
+    void read_color_props(AVS_ScriptEnvironment* env, const AVS_Map* props, pl_frame& frame) noexcept
+    {
+        int err;
+        const auto read{[&](const char* name, const auto& map, auto& target) {
+            const int64_t val{g_avs_api->avs_prop_get_int(env, props, name, 0, &err)};
+            if (!err && val != 2)
+            {
+                if (const auto pl_val{map.find_value(val)})
+                    target = *pl_val;
+            }
+        }};
+
+        read("_Matrix", map_libpl_avs_matrix, frame.repr.sys);
+        read("_ColorRange", map_libpl_avs_levels, frame.repr.levels);
+        read("_Transfer", map_libpl_avs_trc, frame.color.transfer);
+        read("_Primaries", map_libpl_avs_prim, frame.color.primaries);
+    }
+
+    int compare_frames(compare_context* AVS_RESTRICT d, AVS_ScriptEnvironment* env, std::array<AVS_VideoFrame*, 2> frames,
+        std::array<plane_scores, 4>& scores) noexcept
+    {
+        auto& vf{*d->vf};
+        const auto layout{std::span{d->layout}.first(d->num_src_planes)};
+
+        for (int c{0}; c < 2; ++c)
+        {
+            if (!upload_planes(vf, frames[c], layout, d->uploads[c]))
+                return -1;
+        }
+
+        float scale{d->value_scale};
+        if (d->space != compare_space::native)
+        {
+            for (int c{0}; c < 2; ++c)
+            {
+                pl_frame src{d->src_frame};
+                for (int i{0}; i < d->num_src_planes; ++i)
+                    src.planes[i].texture = d->uploads[c][i];
+                read_color_props(env, g_avs_api->avs_get_frame_props_ro(env, frames[c]), src);
+                pl_color_space_infer(&src.color);
+
+                // Same peak and primaries as the source: only the transfer function changes, nothing is tone mapped.
+                pl_frame dst{};
+                dst.num_planes = 1;
+                dst.planes[0].texture = d->rgb[c];
+                dst.planes[0].components = 3;
+                for (int i{0}; i < 3; ++i)
+                    dst.planes[0].component_mapping[i] = i;
+                dst.repr = pl_color_repr_rgb;
+                dst.color = src.color;
+                dst.color.transfer = (d->space == compare_space::linear) ? PL_COLOR_TRC_LINEAR : PL_COLOR_TRC_PQ;
+
+                if (!pl_render_image(vf.rr.get(), &src, &dst, &d->render_params))
+                    return -1;
+
+                // Linear light is normalized to the nominal peak of the source transfer (e.g. 10000 nits for PQ).
+                if (c == 0)
+                    scale = (d->space == compare_space::linear) ? 1.0f / pl_color_transfer_nominal_peak(src.color.transfer) : 1.0f;
+            }
+        }
+
+        for (int p{0}; p < d->num_planes; ++p)
+        {
+            const bool native{d->space == compare_space::native};
+            const pl_tex ta{(native) ? d->uploads[0][p] : d->rgb[0]};
+            const pl_tex tb{(native) ? d->uploads[1][p] : d->rgb[1]};
+            const int ch{(native) ? 0 : p};
+
+            const auto s0{plane_stats(d, ta, tb, ch, scale, d->stats[p][0])};
+            if (!s0)
+                return -1;
+
+            auto& score{scores[p]};
+            const double mse{(*s0)[2]};
+            score.psnr = (mse > 0.0) ? (std::min)(10.0 * std::log10(1.0 / mse), psnr_max) : psnr_max;
+            score.ssim = (*s0)[0];
+            score.ms_ssim = std::numeric_limits<double>::quiet_NaN();
+
+            // Each of the 4 downsampled scales must still fit the SSIM window.
+            if (!d->ms_ssim || ((std::min)(ta->params.w, ta->params.h) >> 4) < 2 * ssim_radius + 1)
+                continue;
+
+            double ms{std::pow((std::max)((*s0)[1], 0.0), ms_ssim_weights[0])};
+            pl_tex pa{ta};
+            pl_tex pb{tb};
+            int pch{ch};
+            float pscale{scale};
+            for (size_t j{1}; j < ms_ssim_weights.size(); ++j)
+            {
+                auto& da{d->scales[0][p][j]};
+                auto& db{d->scales[1][p][j]};
+                if (!downsample(d, pa, pch, pscale, da) || !downsample(d, pb, pch, pscale, db))
+                    return -1;
+
+                pa = da;
+                pb = db;
+                pch = 0;
+                pscale = 1.0f;
+
+                const auto s{plane_stats(d, pa, pb, 0, 1.0f, d->stats[p][j])};
+                if (!s)
+                    return -1;
+
+                // The luminance term only enters at the coarsest scale.
+                const double term{(j + 1 < ms_ssim_weights.size()) ? (*s)[1] : (*s)[0]};
+                ms *= std::pow((std::max)(term, 0.0), ms_ssim_weights[j]);
+            }
+
+            score.ms_ssim = ms;
+        }
+
+        return 0;
+    }
+
+    void log_scores(compare_context* d, int n, const std::array<plane_scores, 4>& scores)
+    {
+        if (!d->log.is_open() || d->logged[n])
+            return;
+
+        d->logged[n] = true;
+        ++d->log_frames;
+        for (int i{0}; i < d->num_planes; ++i)
+        {
+            const auto& s{scores[i]};
+            d->log << std::format("{},{},{:.6f},{:.6f},", n, d->names[i], s.psnr, s.ssim);
+            if (!std::isnan(s.ms_ssim))
+            {
+                d->log << std::format("{:.6f}", s.ms_ssim);
+                d->log_sums[i][2] += s.ms_ssim;
+                ++d->log_ms_count[i];
+            }
+            d->log << '\n';
+
+            d->log_sums[i][0] += s.psnr;
+            d->log_sums[i][1] += s.ssim;
+        }
+    }
+
+    AVS_VideoFrame* AVSC_CC compare_get_frame(AVS_FilterInfo* fi, int n) noexcept
+    {
+        auto* d{reinterpret_cast<compare_context*>(fi->user_data)};
+        const auto& env{fi->env};
+
+        auto a_ptr{avs_helpers::avs_video_frame_ptr{g_avs_api->avs_get_frame(fi->child, n)}};
+        if (!a_ptr)
+            return nullptr;
+        const auto b_ptr{avs_helpers::avs_video_frame_ptr{g_avs_api->avs_get_frame(d->ref.get(), (std::min)(n, d->ref_num_frames - 1))}};
+        if (!b_ptr)
+            return nullptr;
+
+        std::array<plane_scores, 4> scores{};
+        {
+            std::scoped_lock lock(d->mtx);
+            const uint64_t log_mark{d->vf->log_buffer.mark()};
+            if (compare_frames(d, env, {a_ptr.get(), b_ptr.get()}, scores))
+            {
+                fi->error = avs_pool_str(env, std::format("libplacebo_Compare: {}", d->vf->log_buffer.collect(log_mark)));
+                return nullptr;
+            }
+
+            log_scores(d, n, scores);
+        }
+
+        AVS_VideoFrame* dst{a_ptr.release()};
+        g_avs_api->avs_make_property_writable(env, &dst);
+        AVS_Map* props{g_avs_api->avs_get_frame_props_rw(env, dst)};
+        for (int i{0}; i < d->num_planes; ++i)
+        {
+            const auto& s{scores[i]};
+            g_avs_api->avs_prop_set_float(env, props, std::format("PSNR_{}", d->names[i]).c_str(), s.psnr, 0);
+            g_avs_api->avs_prop_set_float(env, props, std::format("SSIM_{}", d->names[i]).c_str(), s.ssim, 0);
+            if (!std::isnan(s.ms_ssim))
+                g_avs_api->avs_prop_set_float(env, props, std::format("MS_SSIM_{}", d->names[i]).c_str(), s.ms_ssim, 0);
+        }
+
+        return dst;
+    }
+
+    void AVSC_CC free_compare(AVS_FilterInfo* fi) noexcept
+    {
+        compare_context* d{reinterpret_cast<compare_context*>(fi->user_data)};
+        delete d;
+    }
+
+    int AVSC_CC compare_set_cache_hints(AVS_FilterInfo* fi, int cachehints, int frame_range) noexcept
+    {
+        if (cachehints != AVS_CACHE_GET_MTMODE)
+            return 0;
+
+        // One instance owns the log file; MT_MULTI_INSTANCE would have every instance truncate it and write its own means.
+        const compare_context* d{reinterpret_cast<compare_context*>(fi->user_data)};
+        return (d->log.is_open()) ? 3 : 2;
+    }
+} // namespace
+
+AVS_Value AVSC_CC create_compare(AVS_ScriptEnvironment* env, AVS_Value args, void* param)
+{
+    AVS_FilterInfo* fi;
+    const avs_helpers::avs_clip_ptr clip_ptr{
+        g_avs_api->avs_new_c_filter(env, &fi, avs_array_elt(args, get_param_idx<"clip", compare_params>()), 1)};
+    AVS_Clip* clip{clip_ptr.get()};
+    auto params{std::make_unique<compare_context>()};
+
+    const auto& vi{fi->vi};
+    if (!avs_is_planar(&vi))
+        return avs_new_value_error("libplacebo_Compare: clip must be in planar format.");
+
+    params->ref = avs_helpers::avs_clip_ptr{g_avs_api->avs_take_clip(avs_array_elt(args, get_param_idx<"ref", compare_params>()), env)};
+    const AVS_VideoInfo* ref_vi{g_avs_api->avs_get_video_info(params->ref.get())};
+    if (ref_vi->width != vi.width || ref_vi->height != vi.height || ref_vi->pixel_type != vi.pixel_type)
+        return avs_new_value_error("libplacebo_Compare: clip and ref must have the same dimensions and format.");
+    params->ref_num_frames = ref_vi->num_frames;
+
+    std::string msg;
+
+    if (const auto space{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"space", compare_params>())})
+    {
+        if (iequals(*space, "native"))
+            params->space = compare_space::native;
+        else if (iequals(*space, "linear"))
+            params->space = compare_space::linear;
+        else if (iequals(*space, "pq"))
+            params->space = compare_space::pq;
+        else
+            return avs_err_val(env, std::format("libplacebo_Compare: invalid space '{}'.", *space));
+    }
+    else
+    {
+        params->space = compare_space::native;
+    }
+
+    params->ms_ssim = avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"ms_ssim", compare_params>()).value_or(false);
+
+    // --- Device Initialization ---
+    {
+        int device{avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"device", compare_params>()).value_or(-1)};
+
+        std::vector<VkPhysicalDevice> devices{};
+        vk_inst_ptr inst;
+        if (const auto dev_info{devices_info(clip, fi->env, devices, inst, device, 0, false)})
+        {
+            fi->user_data = params.release();
+            fi->free_filter = free_compare;
+            return avs_err_val(env, *dev_info);
+        }
+
+        const auto cache_path{avs_helpers::get_opt_arg<const char*>(env, args, get_param_idx<"cache_path", compare_params>())};
+        params->vf = avs_libplacebo_init(inst, devices[device], acquire_shared_cache(device, cache_path.value_or(nullptr)), {}, msg);
+        if (!msg.empty())
+            return avs_err_val(env, std::format("libplacebo_Compare: {}", msg));
+    }
+
+    const auto& gpu{params->vf->vk->gpu};
+
+    // --- Source ---
+    params->is_rgb = avs_is_rgb(&vi);
+    const int comp_size{g_avs_api->avs_component_size(&vi)};
+    const pl_fmt_type fmt_type{(comp_size == 4) ? PL_FMT_FLOAT : PL_FMT_UNORM};
+    params->num_src_planes = source_layout(&vi, fmt_type, params->layout);
+
+    const int bit_depth{g_avs_api->avs_bits_per_component(&vi)};
+    const int sample_depth{comp_size * 8};
+    params->value_scale = (fmt_type == PL_FMT_FLOAT)
+                              ? 1.0f
+                              : static_cast<float>(((1ull << sample_depth) - 1) / static_cast<double>((1ull << bit_depth) - 1));
+
+    // Alpha is not compared.
+    const bool is_gray{params->num_src_planes == 1};
+    if (params->space == compare_space::native)
+    {
+        params->num_planes = (std::min)(params->num_src_planes, 3);
+        params->names = (params->is_rgb) ? decltype(params->names){"R", "G", "B"} : decltype(params->names){"Y", "U", "V"};
+    }
+    else
+    {
+        if (is_gray)
+            return avs_new_value_error("libplacebo_Compare: linear and pq space require a YUV or RGB clip.");
+
+        params->num_planes = 3;
+        params->names = {"R", "G", "B"};
+    }
+
+    auto& src_frame{params->src_frame};
+    src_frame.num_planes = params->num_src_planes;
+    for (int i{0}; i < params->num_src_planes; ++i)
+    {
+        src_frame.planes[i].components = 1;
+        src_frame.planes[i].component_mapping[0] = i;
+    }
+    src_frame.repr = {
+        .sys = (params->is_rgb) ? PL_COLOR_SYSTEM_RGB : PL_COLOR_SYSTEM_BT_709,
+        .levels = (params->is_rgb || bit_depth == 32) ? PL_COLOR_LEVELS_FULL : PL_COLOR_LEVELS_LIMITED,
+        .alpha = (params->num_src_planes > 3) ? PL_ALPHA_INDEPENDENT : PL_ALPHA_NONE,
+        .bits = {.sample_depth = sample_depth, .color_depth = bit_depth},
+    };
+    src_frame.color = (params->is_rgb) ? pl_color_space_srgb : pl_color_space_bt709;
+    if (!params->is_rgb)
+        pl_frame_set_chroma_location(&src_frame, PL_CHROMA_LEFT);
+
+    params->render_params = pl_render_default_params;
+    params->render_params.dither_params = nullptr;
+
+    // --- Textures ---
+    static constexpr pl_fmt_caps caps{static_cast<pl_fmt_caps>(PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_RENDERABLE)};
+    params->stat_fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32, static_cast<pl_fmt_caps>(caps | PL_FMT_CAP_HOST_READABLE));
+    params->gray_fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 32, 32, caps);
+    const pl_fmt rgb_fmt{pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32, caps)};
+    if (!params->stat_fmt || !params->gray_fmt || !rgb_fmt)
+        return avs_new_value_error("libplacebo_Compare: the device doesn't support 32-bit float render targets.");
+
+    if (params->space != compare_space::native)
+    {
+        for (auto& tex : params->rgb)
+        {
+            const pl_tex_params t{
+                .w = vi.width,
+                .h = vi.height,
+                .format = rgb_fmt,
+                .sampleable = true,
+                .renderable = true,
+            };
+
+            tex = pl_tex_create(gpu, &t);
+            if (!tex)
+                return avs_new_value_error("libplacebo_Compare: cannot allocate texture.");
+        }
+    }
+
+    // --- Log ---
+    if (const auto log_path{avs_helpers::get_opt_arg<const char*>(env, args, get_param_idx<"log_path", compare_params>())};
+        log_path && **log_path)
+    {
+        params->log.open(std::filesystem::path{reinterpret_cast<const char8_t*>(*log_path)}, std::ios::trunc);
+        if (!params->log.good())
+            return avs_err_val(env, std::format("libplacebo_Compare: cannot open '{}'.", *log_path));
+
+        params->log << "frame,plane,psnr,ssim,ms_ssim\n";
+        params->logged.resize(vi.num_frames);
+    }
+
+    AVS_Value v;
+    g_avs_api->avs_set_to_clip(&v, clip);
+
+    fi->user_data = params.release();
+    fi->get_frame = compare_get_frame;
+    fi->set_cache_hints = compare_set_cache_hints;
+    fi->free_filter = free_compare;
+
+    return v;
+}
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#include "libplacebo_render.h"
+
+namespace
+{
+    // Text film grain table as written by aomenc/SVT-AV1 (--film-grain-table / --fgs-table) and grav1synth:
+    // "filmgrn1", then per entry "E start end apply_grain random_seed update_parameters" followed, if update_parameters,
+    // by the "p", "sY", "sCb", "sCr", "cY", "cCb" and "cCr" lines of the AV1 film_grain_params().
+    class table_reader
+    {
+    public:
+        explicit table_reader(std::ifstream& f) : f(f)
+        {
+        }
+
+        bool expect(std::string_view token)
+        {
+            std::string s;
+            return (f >> s) && s == token;
+        }
+
+        bool read(int& v, int min, int max)
+        {
+            return (f >> v) && v >= min && v <= max;
+        }
+
+        bool eof()
+        {
+            f >> std::ws;
+            return f.eof();
+        }
+
+    private:
+        std::ifstream& f;
+    };
+
+    bool read_points(table_reader& r, std::string_view tag, int max_points, int& num_points, uint8_t (*points)[2])
+    {
+        if (!r.expect(tag) || !r.read(num_points, 0, max_points))
+            return false;
+
+        for (int i{0}; i < num_points; ++i)
+        {
+            int x;
+            int y;
+            if (!r.read(x, 0, 255) || !r.read(y, 0, 255))
+                return false;
+
+            points[i][0] = static_cast<uint8_t>(x);
+            points[i][1] = static_cast<uint8_t>(y);
+        }
+
+        return true;
+    }
+
+    bool read_coeffs(table_reader& r, std::string_view tag, int num, int8_t* coeffs)
+    {
+        if (!r.expect(tag))
+            return false;
+
+        for (int i{0}; i < num; ++i)
+        {
+            int v;
+            if (!r.read(v, -128, 127))
+                return false;
+
+            coeffs[i] = static_cast<int8_t>(v);
+        }
+
+        return true;
+    }
+
+    bool read_params(table_reader& r, pl_av1_grain_data& data)
+    {
+        int chroma_scaling_from_luma;
+        int overlap;
+        std::array<int, 6> uv{};
+        if (!r.expect("p") || !r.read(data.ar_coeff_lag, 0, 3) || !r.read(data.ar_coeff_shift, 6, 9) ||
+            !r.read(data.grain_scale_shift, 0, 3) || !r.read(data.scaling_shift, 8, 11) || !r.read(chroma_scaling_from_luma, 0, 1) ||
+            !r.read(overlap, 0, 1) || !r.read(uv[0], 0, 255) || !r.read(uv[1], 0, 255) || !r.read(uv[2], 0, 511) ||
+            !r.read(uv[3], 0, 255) || !r.read(uv[4], 0, 255) || !r.read(uv[5], 0, 511))
+            return false;
+
+        data.chroma_scaling_from_luma = chroma_scaling_from_luma;
+        data.overlap = overlap;
+        // The table keeps the bitstream values; libplacebo takes them centered like the decoders.
+        for (int i{0}; i < 2; ++i)
+        {
+            data.uv_mult[i] = static_cast<int8_t>(uv[i * 3] - 128);
+            data.uv_mult_luma[i] = static_cast<int8_t>(uv[i * 3 + 1] - 128);
+            data.uv_offset[i] = static_cast<int16_t>(uv[i * 3 + 2] - 256);
+        }
+
+        const int num_y_coeffs{2 * data.ar_coeff_lag * (data.ar_coeff_lag + 1)};
+        return read_points(r, "sY", 14, data.num_points_y, data.points_y) &&
+               read_points(r, "sCb", 10, data.num_points_uv[0], data.points_uv[0]) &&
+               read_points(r, "sCr", 10, data.num_points_uv[1], data.points_uv[1]) &&
+               read_coeffs(r, "cY", num_y_coeffs, data.ar_coeffs_y) && read_coeffs(r, "cCb", num_y_coeffs + 1, data.ar_coeffs_uv[0]) &&
+               read_coeffs(r, "cCr", num_y_coeffs + 1, data.ar_coeffs_uv[1]);
+    }
+
+    std::shared_ptr<const grain_table> parse_grain_table(const char* path, std::string& err_msg)
+    {
+        std::ifstream f(std::filesystem::path{reinterpret_cast<const char8_t*>(path)});
+        if (!f.good())
+        {
+            err_msg = std::format("film_grain_table: cannot open '{}'.", path);
+            return nullptr;
+        }
+
+        table_reader r(f);
+        if (!r.expect("filmgrn1"))
+        {
+            err_msg = "film_grain_table: not a film grain table.";
+            return nullptr;
+        }
+
+        auto table{std::make_shared<grain_table>()};
+        while (!r.eof())
+        {
+            grain_table_entry entry{};
+            int apply;
+            int seed;
+            int update;
+            if (!r.expect("E") || !(f >> entry.start_time >> entry.end_time) || entry.end_time <= entry.start_time ||
+                !r.read(apply, 0, 1) || !r.read(seed, 0, 65535) || !r.read(update, 0, 1))
+            {
+                err_msg = std::format("film_grain_table: invalid entry {}.", table->size());
+                return nullptr;
+            }
+
+            entry.apply = apply;
+            entry.seed = static_cast<uint16_t>(seed);
+            if (update)
+            {
+                if (!read_params(r, entry.params))
+                {
+                    err_msg = std::format("film_grain_table: invalid parameters in entry {}.", table->size());
+                    return nullptr;
+                }
+            }
+            else if (table->empty())
+            {
+                if (apply)
+                {
+                    err_msg = "film_grain_table: the first entry has no parameters.";
+                    return nullptr;
+                }
+            }
+            else
+            {
+                entry.params = table->back().params;
+            }
+
+            table->emplace_back(entry);
+        }
+
+        std::ranges::sort(*table, {}, &grain_table_entry::start_time);
+        return table;
+    }
+} // namespace
+
+std::shared_ptr<const grain_table> load_grain_table(const char* path, std::string& err_msg)
+{
+    static std::mutex mtx;
+    static std::map<std::string, std::weak_ptr<const grain_table>, std::less<>> tables;
+
+    std::scoped_lock lock(mtx);
+    auto& entry{tables[path]};
+    if (auto table{entry.lock()})
+        return table;
+
+    auto table{parse_grain_table(path, err_msg)};
+    if (table)
+        entry = table;
+
+    return table;
+}
+
+bool grain_for_frame(const grain_table& table, int n, unsigned fps_num, unsigned fps_den, pl_film_grain_data& out) noexcept
+{
+    // Table times are in 10 MHz ticks; the middle of the frame avoids rounding at the entry boundaries.
+    constexpr int64_t ticks{10000000};
+    const int64_t den{static_cast<int64_t>(fps_den) * ticks};
+    const int64_t time{((2 * static_cast<int64_t>(n) + 1) * den) / (2 * static_cast<int64_t>(fps_num))};
+
+    auto it{std::ranges::upper_bound(table, time, {}, &grain_table_entry::start_time)};
+    if (it == table.begin() || time >= (--it)->end_time || !it->apply)
+    {
+        out = {};
+        return false;
+    }
+
+    // The encoders advance the seed by 3381 for every frame after the one that carried the entry.
+    const int64_t frames_into{((time - it->start_time) * fps_num) / den};
+    uint16_t seed{static_cast<uint16_t>(it->seed + 3381 * frames_into)};
+    if (!seed)
+        seed = 7391;
+
+    out = {
+        .type = PL_FILM_GRAIN_AV1,
+        .seed = seed,
+        .params = {.av1 = it->params},
+    };
+    return true;
+}
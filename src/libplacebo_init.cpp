@@ -1,4 +1,9 @@
+#include <chrono>
 #include <format>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 #include "libplacebo_render.h"
 
@@ -10,13 +15,80 @@ static void pl_logging_cb(void* log_priv, pl_log_level level, const char* msg) n
         return;
 
     auto* p{static_cast<priv*>(log_priv)};
-    p->log_buffer << std::format("[libplacebo] {}\n", msg);
+    p->log_buffer.push(msg);
 
     if (level <= PL_LOG_WARN)
-        std::fputs(std::format("[libplacebo] {}\n", msg).c_str(), stderr);
+        std::fprintf(stderr, "[libplacebo] %s\n", msg);
 }
 
-std::unique_ptr<priv> avs_libplacebo_init(vk_inst_ptr& inst, const VkPhysicalDevice device, std::string& err_msg)
+shared_cache::~shared_cache()
+{
+    if (path.empty() || !obj || signature == pl_cache_signature(obj.get()))
+        return;
+
+    const size_t size{pl_cache_save(obj.get(), nullptr, 0)};
+    std::vector<std::byte> data(size);
+    const size_t written{pl_cache_save(obj.get(), reinterpret_cast<uint8_t*>(data.data()), size)};
+    if (written == 0)
+        return;
+
+    if (const auto parent{path.parent_path()}; !parent.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(parent, ec);
+    }
+
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (f.good())
+        f.write(reinterpret_cast<const char*>(data.data()), written);
+}
+
+std::shared_ptr<shared_cache> acquire_shared_cache(int device, const char* path)
+{
+    static std::mutex mtx;
+    static std::map<std::string, std::weak_ptr<shared_cache>, std::less<>> caches;
+
+    const std::string key{std::format("{}|{}", device, (path) ? path : "")};
+
+    std::scoped_lock lock(mtx);
+    if (auto cache{caches[key].lock()})
+        return cache;
+
+    auto cache{std::make_shared<shared_cache>()};
+    // 50MB limit should be reasonable default
+    // A single object may take the whole budget so that large lut3d_size gamut LUTs are still cached.
+    const pl_cache_params cache_params{
+        .max_object_size = 50 * 1024 * 1024,
+        .max_total_size = 50 * 1024 * 1024,
+    };
+    cache->obj.reset(pl_cache_create(&cache_params));
+
+    if (path && *path)
+    {
+        cache->path = path;
+        std::error_code ec;
+
+        if (std::filesystem::is_regular_file(cache->path, ec))
+        {
+            const auto size{std::filesystem::file_size(cache->path, ec)};
+            if (!ec && size > 0)
+            {
+                std::vector<std::byte> data(size);
+                std::ifstream f(cache->path, std::ios::binary);
+                if (f.read(reinterpret_cast<char*>(data.data()), size))
+                    pl_cache_load(cache->obj.get(), reinterpret_cast<const uint8_t*>(data.data()), size);
+            }
+        }
+
+        cache->signature = pl_cache_signature(cache->obj.get());
+    }
+
+    caches[key] = cache;
+    return cache;
+}
+
+std::unique_ptr<priv> avs_libplacebo_init(vk_inst_ptr& inst, const VkPhysicalDevice device, std::shared_ptr<shared_cache> cache,
+    const vk_queue_options& queues, std::string& err_msg)
 {
     std::unique_ptr<priv> p{std::make_unique<priv>()};
     p->vk_inst = std::move(inst);
@@ -33,41 +105,209 @@ std::unique_ptr<priv> avs_libplacebo_init(vk_inst_ptr& inst, const VkPhysicalDev
     vp.device = device;
     vp.allow_software = true;
     vp.max_api_version = PL_VK_MIN_VERSION;
+    // Uploads/downloads on a transfer queue and compute shaders on a compute queue can overlap with rendering.
+    vp.async_transfer = queues.async_transfer;
+    vp.async_compute = queues.async_compute;
+    vp.queue_count = queues.queue_count;
 
     p->vk.reset(pl_vulkan_create(p->log.get(), &vp));
     if (!p->vk)
     {
-        err_msg = p->log_buffer.str();
+        err_msg = p->log_buffer.collect();
         return nullptr;
     }
 
     const auto& gpu{p->vk->gpu};
-    // 50MB limit should be reasonable default
-    pl_cache_params cache_params{
-        .log = p->log.get(),
-        .max_total_size = 50 * 1024 * 1024,
-    };
-    p->cache_obj.reset(pl_cache_create(&cache_params));
-    pl_gpu_set_cache(gpu, p->cache_obj.get());
+    p->cache_obj = std::move(cache);
+    pl_gpu_set_cache(gpu, p->cache_obj->obj.get());
 
     p->dp.reset(pl_dispatch_create(p->log.get(), gpu));
     if (!p->dp)
     {
-        err_msg = p->log_buffer.str();
+        err_msg = p->log_buffer.collect();
         return nullptr;
     }
 
     p->rr.reset(pl_renderer_create(p->log.get(), gpu));
     if (!p->rr)
     {
-        err_msg = p->log_buffer.str();
+        err_msg = p->log_buffer.collect();
         return nullptr;
     }
     return p;
 }
 
-std::optional<std::string> devices_info(
-    AVS_Clip* clip, AVS_ScriptEnvironment* env, std::vector<VkPhysicalDevice>& devices, vk_inst_ptr& inst, int& device, int list_devices)
+struct device_benchmark
+{
+    double upload_gbps;
+    double download_gbps;
+    double render_fps; // 1080p -> 2160p, high quality preset
+};
+
+static uint64_t device_vram(VkPhysicalDevice device) noexcept
+{
+    VkPhysicalDeviceMemoryProperties mem{};
+    vkGetPhysicalDeviceMemoryProperties(device, &mem);
+
+    uint64_t size{0};
+    for (uint32_t i{0}; i < mem.memoryHeapCount; ++i)
+    {
+        if (mem.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            size += mem.memoryHeaps[i].size;
+    }
+    return size;
+}
+
+static int device_type_rank(VkPhysicalDeviceType type) noexcept
+{
+    switch (type)
+    {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            return 3;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            return 2;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static std::optional<device_benchmark> run_benchmark(VkInstance inst, VkPhysicalDevice device)
+{
+    pl_vulkan_params vp{};
+    vp.instance = inst;
+    vp.device = device;
+    vp.allow_software = true;
+    vp.max_api_version = PL_VK_MIN_VERSION;
+
+    const pl_vulkan_ptr vk{pl_vulkan_create(nullptr, &vp)};
+    if (!vk)
+        return std::nullopt;
+
+    const auto& gpu{vk->gpu};
+    const pl_fmt fmt{pl_find_fmt(gpu, PL_FMT_UNORM, 4, 8, 8,
+        static_cast<pl_fmt_caps>(PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_HOST_READABLE))};
+    if (!fmt)
+        return std::nullopt;
+
+    static constexpr int width{1920};
+    static constexpr int height{1080};
+    static constexpr int runs{8};
+
+    const pl_tex_params src_params{
+        .w = width,
+        .h = height,
+        .format = fmt,
+        .sampleable = true,
+        .host_writable = true,
+        .host_readable = true,
+    };
+    const pl_tex_params dst_params{
+        .w = width * 2,
+        .h = height * 2,
+        .format = fmt,
+        .renderable = true,
+    };
+
+    pl_tex src{pl_tex_create(gpu, &src_params)};
+    pl_tex dst{pl_tex_create(gpu, &dst_params)};
+    const pl_renderer_ptr rr{pl_renderer_create(nullptr, gpu)};
+
+    std::optional<device_benchmark> result;
+    if (src && dst && rr)
+    {
+        std::vector<std::byte> data(static_cast<size_t>(width) * height * 4);
+        const pl_tex_transfer_params ttr{
+            .tex = src,
+            .ptr = data.data(),
+        };
+
+        const auto seconds_of{[&](auto&& op) -> double {
+            const auto start{std::chrono::steady_clock::now()};
+            for (int i{0}; i < runs; ++i)
+            {
+                if (!op())
+                    return -1.0;
+            }
+            pl_gpu_finish(gpu);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }};
+
+        const auto make_frame{[](pl_tex tex) {
+            pl_frame frame{
+                .num_planes = 1,
+                .repr = pl_color_repr_rgb,
+                .color = pl_color_space_srgb,
+            };
+            frame.planes[0] = {.texture = tex, .components = 4, .component_mapping = {0, 1, 2, 3}};
+            return frame;
+        }};
+        const pl_frame src_frame{make_frame(src)};
+        const pl_frame dst_frame{make_frame(dst)};
+        const auto render{[&]() { return pl_render_image(rr.get(), &src_frame, &dst_frame, &pl_render_high_quality_params); }};
+
+        // Warm up: shader compilation and LUT generation are not part of the figures.
+        if (render() && pl_tex_upload(gpu, &ttr) && pl_tex_download(gpu, &ttr))
+        {
+            pl_gpu_finish(gpu);
+
+            const double bytes{static_cast<double>(data.size()) * runs};
+            const double up{seconds_of([&]() { return pl_tex_upload(gpu, &ttr); })};
+            const double down{seconds_of([&]() { return pl_tex_download(gpu, &ttr); })};
+            const double rend{seconds_of(render)};
+            if (up > 0.0 && down > 0.0 && rend > 0.0)
+                result = device_benchmark{bytes / up / 1e9, bytes / down / 1e9, runs / rend};
+        }
+    }
+
+    pl_tex_destroy(gpu, &dst);
+    pl_tex_destroy(gpu, &src);
+    return result;
+}
+
+// Results are kept for the lifetime of the process; the device is identified by its properties because handles differ per instance.
+static std::optional<device_benchmark> cached_benchmark(VkInstance inst, VkPhysicalDevice device)
+{
+    static std::mutex mtx;
+    static std::map<std::string, std::optional<device_benchmark>, std::less<>> results;
+
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(device, &props);
+    const std::string key{std::format("{}|{:x}|{:x}|{}", props.deviceName, props.vendorID, props.deviceID, props.driverVersion)};
+
+    std::scoped_lock lock(mtx);
+    if (const auto it{results.find(key)}; it != results.end())
+        return it->second;
+
+    return results[key] = run_benchmark(inst, device);
+}
+
+std::string device_description(VkInstance inst, VkPhysicalDevice device, bool benchmark)
+{
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(device, &props);
+
+    static constexpr std::array type_names{"other", "integrated", "discrete", "virtual", "cpu"};
+    const auto type{static_cast<size_t>(props.deviceType)};
+
+    std::string desc{std::format("{} ({}, {} MiB VRAM{})", props.deviceName, (type < type_names.size()) ? type_names[type] : "other",
+        device_vram(device) >> 20, (props.limits.timestampComputeAndGraphics) ? ", timestamps" : "")};
+
+    if (benchmark)
+    {
+        if (const auto bench{cached_benchmark(inst, device)})
+            desc += std::format(" upload {:.2f} GB/s, download {:.2f} GB/s, render {:.1f} fps", bench->upload_gbps, bench->download_gbps,
+                bench->render_fps);
+        else
+            desc += " benchmark failed";
+    }
+
+    return desc;
+}
+
+std::optional<std::string> devices_info(AVS_Clip* clip, AVS_ScriptEnvironment* env, std::vector<VkPhysicalDevice>& devices,
+    vk_inst_ptr& inst, int& device, int list_devices, bool benchmark)
 {
     uint32_t instance_version{VK_API_VERSION_1_0};
     if (vkEnumerateInstanceVersion != nullptr)
@@ -101,19 +341,14 @@ std::optional<std::string> devices_info(
 
     if (device == -1 || list_devices)
     {
-        auto score_of{[](VkPhysicalDevice d) {
+        // Device type first, then measured render speed (if benchmarked), VRAM size and timestamp support.
+        auto score_of{[&](VkPhysicalDevice d) {
             VkPhysicalDeviceProperties props;
             vkGetPhysicalDeviceProperties(d, &props);
 
-            switch (props.deviceType)
-            {
-                case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
-                    return 10;
-                case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
-                    return 5;
-                default:
-                    return 0;
-            }
+            const auto bench{(benchmark) ? cached_benchmark(inst.get(), d) : std::nullopt};
+            return std::tuple{device_type_rank(props.deviceType), (bench) ? bench->render_fps : 0.0, device_vram(d),
+                static_cast<bool>(props.limits.timestampComputeAndGraphics)};
         }};
 
         auto it{std::ranges::max_element(devices, std::less<>{}, score_of)};
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
-#include <sstream>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
 
 #include "avs_c_api_loader.hpp"
 #include "utils.h"
@@ -9,18 +15,105 @@
 extern "C" {
 #include "libplacebo/dispatch.h"
 #include "libplacebo/shaders.h"
+#include "libplacebo/shaders/film_grain.h"
 #include "libplacebo/utils/upload.h"
 }
 
-std::unique_ptr<struct priv> avs_libplacebo_init(vk_inst_ptr& inst, const VkPhysicalDevice device, std::string& err_msg);
+// pl_cache shared by all instances on the same device and cache_path (compiled shaders, pipeline cache, tone/gamut mapping LUTs).
+// Written back to `path` when the last instance releases it.
+struct shared_cache
+{
+    pl_cache_ptr obj;
+    std::filesystem::path path;
+    uint64_t signature{};
+
+    ~shared_cache();
+};
+
+std::shared_ptr<shared_cache> acquire_shared_cache(int device, const char* path);
+
+struct vk_queue_options
+{
+    bool async_transfer{true};
+    bool async_compute{true};
+    int queue_count{1};
+};
+
+std::unique_ptr<struct priv> avs_libplacebo_init(vk_inst_ptr& inst, const VkPhysicalDevice device, std::shared_ptr<shared_cache> cache,
+    const vk_queue_options& queues, std::string& err_msg);
+
+std::optional<std::string> devices_info(AVS_Clip* clip, AVS_ScriptEnvironment* env, std::vector<VkPhysicalDevice>& devices,
+    vk_inst_ptr& inst, int& device, int list_devices, bool benchmark);
+std::string device_description(VkInstance inst, VkPhysicalDevice device, bool benchmark);
+
+// Fixed-capacity ring of the most recent libplacebo messages.
+// push() is lock-free; a reader skips slots that are overwritten while being copied.
+class log_ring
+{
+public:
+    static constexpr size_t CAPACITY{64};
+    static constexpr size_t MSG_SIZE{256};
+
+    void push(const char* msg) noexcept
+    {
+        const uint64_t idx{head.fetch_add(1, std::memory_order_relaxed)};
+        auto& e{entries[idx % CAPACITY]};
+        e.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const size_t len{std::min(std::strlen(msg), MSG_SIZE - 1)};
+        std::memcpy(e.text.data(), msg, len);
+        e.text[len] = '\0';
+
+        e.seq.store(idx + 1, std::memory_order_release);
+    }
+
+    // Position to pass to collect() to get only the messages logged after this call.
+    uint64_t mark() const noexcept
+    {
+        return head.load(std::memory_order_acquire);
+    }
+
+    std::string collect(uint64_t since = 0) const
+    {
+        const uint64_t end{head.load(std::memory_order_acquire)};
+        std::string out;
+        for (uint64_t i{std::max(since, (end > CAPACITY) ? end - CAPACITY : 0)}; i < end; ++i)
+        {
+            const auto& e{entries[i % CAPACITY]};
+            if (e.seq.load(std::memory_order_acquire) != i + 1)
+                continue;
+
+            std::array<char, MSG_SIZE> text;
+            std::memcpy(text.data(), e.text.data(), MSG_SIZE);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (e.seq.load(std::memory_order_relaxed) != i + 1)
+                continue;
+
+            text.back() = '\0';
+            out += "[libplacebo] ";
+            out += text.data();
+            out += '\n';
+        }
+        return out;
+    }
+
+private:
+    struct entry
+    {
+        std::atomic<uint64_t> seq{};
+        std::array<char, MSG_SIZE> text{};
+    };
 
-std::optional<std::string> devices_info(
-    AVS_Clip* clip, AVS_ScriptEnvironment* env, std::vector<VkPhysicalDevice>& devices, vk_inst_ptr& inst, int& device, int list_devices);
+    std::array<entry, CAPACITY> entries;
+    std::atomic<uint64_t> head{};
+};
 
 struct cached_frame
 {
     int frame_idx{-1};
     uint64_t last_used{};
+    int num_planes{}; // uploaded planes
     std::array<pl_tex, 4> planes{};
 };
 
@@ -29,10 +122,10 @@ struct priv
     vk_inst_ptr vk_inst;
 
     pl_log_ptr log;
+    // Declared before vk: the gpu writes its pipeline cache into it on destruction.
+    std::shared_ptr<shared_cache> cache_obj;
     pl_vulkan_ptr vk;
 
-    pl_cache_ptr cache_obj;
-
     pl_dispatch_ptr dp;
     pl_renderer_ptr rr;
 
@@ -44,7 +137,7 @@ struct priv
     pl_tex fix_fbo_in;
     pl_tex fix_fbo_out;
 
-    std::ostringstream log_buffer;
+    log_ring log_buffer;
 
     ~priv()
     {
@@ -66,4 +159,47 @@ struct priv
 };
 
 AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void* param);
+AVS_Value AVSC_CC create_compare(AVS_ScriptEnvironment* env, AVS_Value args, void* param);
+
+// One source texture: an AviSynth plane (AVS_DEFAULT_PLANE for packed formats) and the layout of its pixels.
+// width, height, row_stride and pixels of `data` are set for every frame.
+struct plane_upload
+{
+    int plane;
+    pl_plane_data data;
+};
+
+// Number of textures a frame of `vi` is uploaded to, 0 if the format is not supported.
+// Planar formats use one texture per plane, packed RGB one texture (stored bottom-up), YUY2 a luma and a chroma texture.
+int source_layout(const AVS_VideoInfo* vi, pl_fmt_type type, std::array<plane_upload, 4>& layout) noexcept;
+
+// Uploads an AviSynth frame to `textures`. AviSynth float chroma (centered at 0) is shifted to libplacebo's range.
+// Every plane upload is measured with `timer` if it is set.
+bool upload_planes(priv& vf, AVS_VideoFrame* src, std::span<const plane_upload> layout, std::array<pl_tex, 4>& textures,
+    pl_timer timer = nullptr) noexcept;
 std::unique_ptr<pl_dovi_metadata> create_dovi_meta(DoviRpuOpaque* rpu, const DoviRpuDataHeader& hdr);
+
+std::shared_ptr<const pl_custom_lut> load_lut(const char* path, std::string& err_msg);
+bool save_lut(const pl_custom_lut& lut, const char* path, std::string& err_msg);
+
+#ifdef _WIN32
+// Converts `s` from the code page `cp` (CP_UTF8, CP_ACP) for the wide-character file APIs.
+std::wstring to_wide(const char* s, unsigned cp);
+#endif
+
+// AV1 film grain parameters of a grain table entry, for [start_time, end_time) in 10 MHz ticks.
+struct grain_table_entry
+{
+    int64_t start_time;
+    int64_t end_time;
+    bool apply;
+    uint16_t seed;
+    pl_av1_grain_data params;
+};
+
+using grain_table = std::vector<grain_table_entry>;
+
+// Instances using the same file share the parsed table.
+std::shared_ptr<const grain_table> load_grain_table(const char* path, std::string& err_msg);
+// Film grain of frame `n`; false (and no grain in `out`) if the table has none for it.
+bool grain_for_frame(const grain_table& table, int n, unsigned fps_num, unsigned fps_den, pl_film_grain_data& out) noexcept;
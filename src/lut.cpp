@@ -0,0 +1,387 @@
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "libplacebo_render.h"
+
+#ifdef _WIN32
+std::wstring to_wide(const char* s, unsigned cp)
+{
+    const int size = MultiByteToWideChar(cp, 0, s, -1, nullptr, 0);
+    std::wstring w(size, 0);
+    MultiByteToWideChar(cp, 0, s, -1, w.data(), size);
+    return w;
+}
+#endif
+
+namespace
+{
+    // Binary LUT container, in the byte order of the machine that wrote it (byte_order = lut_byte_order):
+    // header, followed by size[0] * size[1] * size[2] RGB float32 triples at data_offset (same layout as pl_custom_lut::data).
+    // 1D LUTs have size[1] = size[2] = 0.
+    struct lut_file_repr
+    {
+        int32_t sys;
+        int32_t levels;
+        int32_t alpha;
+        int32_t sample_depth;
+        int32_t color_depth;
+        int32_t bit_shift;
+    };
+
+    // The static HDR metadata of the color space, the dynamic (per scene) values don't apply to a LUT.
+    struct lut_file_color
+    {
+        int32_t primaries;
+        int32_t transfer;
+        std::array<float, 8> prim;
+        float min_luma;
+        float max_luma;
+        float max_cll;
+        float max_fall;
+    };
+
+    struct lut_file_header
+    {
+        std::array<char, 8> magic;
+        uint32_t byte_order;
+        uint32_t version;
+        uint32_t sample_type; // 0: float32
+        std::array<int32_t, 3> size;
+        uint32_t data_offset;
+        uint32_t reserved;
+        uint64_t signature;
+        std::array<float, 9> shaper_in;
+        std::array<float, 9> shaper_out;
+        lut_file_repr repr_in;
+        lut_file_repr repr_out;
+        lut_file_color color_in;
+        lut_file_color color_out;
+        std::array<uint32_t, 2> padding;
+    };
+
+    static_assert(sizeof(lut_file_header) % 16 == 0);
+
+    inline constexpr std::array<char, 8> lut_magic{'P', 'L', 'C', 'L', 'U', 'T', '\0', '\0'};
+    inline constexpr uint32_t lut_byte_order{0x01020304};
+    inline constexpr uint32_t lut_version{2};
+
+    lut_file_repr to_file(const pl_color_repr& repr) noexcept
+    {
+        return {
+            .sys = static_cast<int32_t>(repr.sys),
+            .levels = static_cast<int32_t>(repr.levels),
+            .alpha = static_cast<int32_t>(repr.alpha),
+            .sample_depth = repr.bits.sample_depth,
+            .color_depth = repr.bits.color_depth,
+            .bit_shift = repr.bits.bit_shift,
+        };
+    }
+
+    lut_file_color to_file(const pl_color_space& color) noexcept
+    {
+        const auto& prim{color.hdr.prim};
+        return {
+            .primaries = static_cast<int32_t>(color.primaries),
+            .transfer = static_cast<int32_t>(color.transfer),
+            .prim = {prim.red.x, prim.red.y, prim.green.x, prim.green.y, prim.blue.x, prim.blue.y, prim.white.x, prim.white.y},
+            .min_luma = color.hdr.min_luma,
+            .max_luma = color.hdr.max_luma,
+            .max_cll = color.hdr.max_cll,
+            .max_fall = color.hdr.max_fall,
+        };
+    }
+
+    bool from_file(const lut_file_repr& in, pl_color_repr& repr) noexcept
+    {
+        if (in.sys < 0 || in.sys >= PL_COLOR_SYSTEM_COUNT || in.levels < 0 || in.levels >= PL_COLOR_LEVELS_COUNT || in.alpha < 0 ||
+            in.alpha >= PL_ALPHA_MODE_COUNT)
+            return false;
+
+        repr = {
+            .sys = static_cast<pl_color_system>(in.sys),
+            .levels = static_cast<pl_color_levels>(in.levels),
+            .alpha = static_cast<pl_alpha_mode>(in.alpha),
+            .bits = {.sample_depth = in.sample_depth, .color_depth = in.color_depth, .bit_shift = in.bit_shift},
+        };
+        return true;
+    }
+
+    bool from_file(const lut_file_color& in, pl_color_space& color) noexcept
+    {
+        if (in.primaries < 0 || in.primaries >= PL_COLOR_PRIM_COUNT || in.transfer < 0 || in.transfer >= PL_COLOR_TRC_COUNT)
+            return false;
+
+        const auto& p{in.prim};
+        color = {
+            .primaries = static_cast<pl_color_primaries>(in.primaries),
+            .transfer = static_cast<pl_color_transfer>(in.transfer),
+            .hdr = {
+                .prim = {.red = {p[0], p[1]}, .green = {p[2], p[3]}, .blue = {p[4], p[5]}, .white = {p[6], p[7]}},
+                .min_luma = in.min_luma,
+                .max_luma = in.max_luma,
+                .max_cll = in.max_cll,
+                .max_fall = in.max_fall,
+            },
+        };
+        return true;
+    }
+
+    struct mapped_file
+    {
+        const std::byte* ptr{};
+        size_t size{};
+
+        mapped_file() = default;
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        bool open(const char* path, std::string& err_msg)
+        {
+#ifdef _WIN32
+            HANDLE file{CreateFileW(
+                to_wide(path, CP_UTF8).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr)};
+            if (file == INVALID_HANDLE_VALUE)
+                file = CreateFileW(
+                    to_wide(path, CP_ACP).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                err_msg = std::format("error opening file (error {}).", GetLastError());
+                return false;
+            }
+
+            LARGE_INTEGER file_size{};
+            if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+            {
+                CloseHandle(file);
+                err_msg = "error determining file size or file is empty.";
+                return false;
+            }
+
+            HANDLE mapping{CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+            CloseHandle(file);
+            if (!mapping)
+            {
+                err_msg = std::format("error mapping file (error {}).", GetLastError());
+                return false;
+            }
+
+            void* view{MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)};
+            CloseHandle(mapping);
+            if (!view)
+            {
+                err_msg = std::format("error mapping file (error {}).", GetLastError());
+                return false;
+            }
+
+            ptr = static_cast<const std::byte*>(view);
+            size = static_cast<size_t>(file_size.QuadPart);
+#else
+            const int fd{::open(path, O_RDONLY)};
+            if (fd < 0)
+            {
+                err_msg = std::format("error opening file: {}", std::strerror(errno));
+                return false;
+            }
+
+            struct stat st{};
+            if (fstat(fd, &st) || st.st_size <= 0)
+            {
+                ::close(fd);
+                err_msg = "error determining file size or file is empty.";
+                return false;
+            }
+
+            void* view{mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0)};
+            ::close(fd);
+            if (view == MAP_FAILED)
+            {
+                err_msg = std::format("error mapping file: {}", std::strerror(errno));
+                return false;
+            }
+
+            ptr = static_cast<const std::byte*>(view);
+            size = static_cast<size_t>(st.st_size);
+#endif
+            return true;
+        }
+
+        ~mapped_file()
+        {
+            if (!ptr)
+                return;
+#ifdef _WIN32
+            UnmapViewOfFile(ptr);
+#else
+            munmap(const_cast<std::byte*>(ptr), size);
+#endif
+        }
+    };
+
+    // Keeps the mapping alive for as long as the LUT that points into it.
+    struct mapped_lut
+    {
+        mapped_file file;
+        pl_custom_lut lut{};
+    };
+
+    std::shared_ptr<const pl_custom_lut> map_binary_lut(std::shared_ptr<mapped_lut> m, std::string& err_msg)
+    {
+        const auto& file{m->file};
+        lut_file_header hdr;
+        std::memcpy(&hdr, file.ptr, sizeof(hdr));
+
+        if (hdr.byte_order != lut_byte_order)
+        {
+            err_msg = "binary LUT was written with a different byte order.";
+            return nullptr;
+        }
+
+        if (hdr.version != lut_version || hdr.sample_type != 0)
+        {
+            err_msg = std::format("unsupported binary LUT version {} / sample type {}.", hdr.version, hdr.sample_type);
+            return nullptr;
+        }
+
+        const auto& size{hdr.size};
+        const bool is_1d{size[1] == 0 && size[2] == 0};
+        if (size[0] <= 0 || (!is_1d && (size[1] <= 0 || size[2] <= 0)))
+        {
+            err_msg = "invalid binary LUT dimensions.";
+            return nullptr;
+        }
+
+        const size_t num_values{static_cast<size_t>(size[0]) * (is_1d ? 1 : static_cast<size_t>(size[1]) * size[2]) * 3};
+        if (hdr.data_offset < sizeof(hdr) || hdr.data_offset % alignof(float) || hdr.data_offset > file.size ||
+            (file.size - hdr.data_offset) / sizeof(float) < num_values)
+        {
+            err_msg = "binary LUT file is truncated.";
+            return nullptr;
+        }
+
+        auto& lut{m->lut};
+        lut.signature = hdr.signature;
+        for (int i{0}; i < 3; ++i)
+            lut.size[i] = size[i];
+        lut.data = reinterpret_cast<const float*>(file.ptr + hdr.data_offset);
+        std::memcpy(&lut.shaper_in.m[0][0], hdr.shaper_in.data(), sizeof(lut.shaper_in.m));
+        std::memcpy(&lut.shaper_out.m[0][0], hdr.shaper_out.data(), sizeof(lut.shaper_out.m));
+        if (!from_file(hdr.repr_in, lut.repr_in) || !from_file(hdr.repr_out, lut.repr_out) || !from_file(hdr.color_in, lut.color_in) ||
+            !from_file(hdr.color_out, lut.color_out))
+        {
+            err_msg = "invalid binary LUT color space.";
+            return nullptr;
+        }
+
+        const pl_custom_lut* p{&lut};
+        return std::shared_ptr<const pl_custom_lut>(std::move(m), p);
+    }
+} // namespace
+
+std::shared_ptr<const pl_custom_lut> load_lut(const char* path, std::string& err_msg)
+{
+    static std::mutex mtx;
+    static std::map<std::string, std::weak_ptr<const pl_custom_lut>, std::less<>> luts;
+
+    std::string key;
+    {
+        std::error_code ec;
+        const std::filesystem::path fs_path{reinterpret_cast<const char8_t*>(path)};
+        const auto size{std::filesystem::file_size(fs_path, ec)};
+        if (!ec)
+        {
+            const auto mtime{std::filesystem::last_write_time(fs_path, ec)};
+            if (!ec)
+                key = std::format("{}|{}|{}", path, mtime.time_since_epoch().count(), size);
+        }
+    }
+
+    std::scoped_lock lock(mtx);
+    // LUTs no instance uses anymore, including the previous versions of an edited file, are dropped.
+    std::erase_if(luts, [](const auto& entry) { return entry.second.expired(); });
+    if (!key.empty())
+    {
+        if (const auto it{luts.find(key)}; it != luts.end())
+        {
+            if (auto lut{it->second.lock()})
+                return lut;
+        }
+    }
+
+    auto m{std::make_shared<mapped_lut>()};
+    if (!m->file.open(path, err_msg))
+        return nullptr;
+
+    std::shared_ptr<const pl_custom_lut> lut;
+    const auto& file{m->file};
+    if (file.size >= sizeof(lut_file_header) && !std::memcmp(file.ptr, lut_magic.data(), lut_magic.size()))
+    {
+        lut = map_binary_lut(std::move(m), err_msg);
+        if (!lut)
+            return nullptr;
+    }
+    else
+    {
+        lut.reset(pl_lut_parse_cube(nullptr, reinterpret_cast<const char*>(file.ptr), file.size), pl_custom_lut_deleter{});
+        if (!lut)
+        {
+            err_msg = "failed lut parsing.";
+            return nullptr;
+        }
+    }
+
+    if (!key.empty())
+        luts.insert_or_assign(std::move(key), lut);
+
+    return lut;
+}
+
+bool save_lut(const pl_custom_lut& lut, const char* path, std::string& err_msg)
+{
+    const bool is_1d{lut.size[1] == 0 && lut.size[2] == 0};
+    const size_t num_values{static_cast<size_t>(lut.size[0]) * (is_1d ? 1 : static_cast<size_t>(lut.size[1]) * lut.size[2]) * 3};
+    if (!lut.data || !num_values)
+    {
+        err_msg = "lut_export: LUT has no data.";
+        return false;
+    }
+
+    lut_file_header hdr{
+        .magic = lut_magic,
+        .byte_order = lut_byte_order,
+        .version = lut_version,
+        .sample_type = 0,
+        .size = {lut.size[0], lut.size[1], lut.size[2]},
+        .data_offset = sizeof(lut_file_header),
+        .signature = lut.signature,
+        .repr_in = to_file(lut.repr_in),
+        .repr_out = to_file(lut.repr_out),
+        .color_in = to_file(lut.color_in),
+        .color_out = to_file(lut.color_out),
+    };
+    std::memcpy(hdr.shaper_in.data(), &lut.shaper_in.m[0][0], sizeof(lut.shaper_in.m));
+    std::memcpy(hdr.shaper_out.data(), &lut.shaper_out.m[0][0], sizeof(lut.shaper_out.m));
+
+    std::ofstream f(std::filesystem::path{reinterpret_cast<const char8_t*>(path)}, std::ios::binary | std::ios::trunc);
+    if (!f.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr)) ||
+        !f.write(reinterpret_cast<const char*>(lut.data), static_cast<std::streamsize>(num_values * sizeof(float))))
+    {
+        err_msg = std::format("lut_export: error writing '{}'.", path);
+        return false;
+    }
+
+    return true;
+}
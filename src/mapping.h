@@ -10,7 +10,7 @@ constexpr unsigned char ascii_tolower(unsigned char c) noexcept
     return c + (c >= 'A' && c <= 'Z') * 32;
 }
 
-bool iequals(std::string_view a, std::string_view b) noexcept
+inline bool iequals(std::string_view a, std::string_view b) noexcept
 {
     return std::ranges::equal(a, b, [](char ca, char cb) { return ascii_tolower(ca) == ascii_tolower(cb); });
 }
@@ -332,6 +332,21 @@ inline constexpr Map<std::string_view, int, 3> parse_aspect_mode{{{
     {"fill", 2},
 }}};
 
+// 0: renderer default (16-bit float/unorm), 1: 8-bit, 2: no intermediate textures
+inline constexpr Map<std::string_view, int, 3> parse_intermediate_precision{{{
+    {"auto", 0},
+    {"low", 1},
+    {"none", 2},
+}}};
+
+inline constexpr Map<std::string_view, pl_log_level, 5> parse_log_level{{{
+    {"error", PL_LOG_ERR},
+    {"warn", PL_LOG_WARN},
+    {"info", PL_LOG_INFO},
+    {"debug", PL_LOG_DEBUG},
+    {"trace", PL_LOG_TRACE},
+}}};
+
 inline constexpr Map<std::string_view, pl_clear_mode, 3> parse_clear_mode{{{
     {"color", PL_CLEAR_COLOR},
     //{"tiles", PL_CLEAR_TILES},
@@ -339,7 +354,7 @@ inline constexpr Map<std::string_view, pl_clear_mode, 3> parse_clear_mode{{{
     {"blur", PL_CLEAR_BLUR},
 }}};
 
-bool apply_csp_preset(std::string_view str, pl_color_space& csp, pl_color_repr& repr, std::string_view* out_fmt = nullptr) noexcept
+inline bool apply_csp_preset(std::string_view str, pl_color_space& csp, pl_color_repr& repr, std::string_view* out_fmt = nullptr) noexcept
 {
     struct csp_preset
     {
@@ -419,7 +434,7 @@ bool apply_csp_preset(std::string_view str, pl_color_space& csp, pl_color_repr&
     return false; // Unknown preset
 }
 
-bool parse_out_fmt(std::string_view str, AVS_VideoInfo* vi, bool& is_rgb) noexcept
+inline bool parse_out_fmt(std::string_view str, AVS_VideoInfo* vi, bool& is_rgb) noexcept
 {
     struct format_info
     {
@@ -429,7 +444,7 @@ bool parse_out_fmt(std::string_view str, AVS_VideoInfo* vi, bool& is_rgb) noexce
         bool is_rgb;
     };
 
-    static constexpr std::array<format_info, 54> video_formats{{
+    static constexpr std::array<format_info, 57> video_formats{{
         {"Y8", "", AVS_CS_Y8, false},
         {"YUV420P8", "YV12", AVS_CS_YV12, false},
         {"YUV422P8", "YV16", AVS_CS_YV16, false},
@@ -495,6 +510,10 @@ bool parse_out_fmt(std::string_view str, AVS_VideoInfo* vi, bool& is_rgb) noexce
         {"YUVA422PS", "", AVS_CS_YUVA422PS, false},
         {"YUVA444PS", "", AVS_CS_YUVA444PS, false},
         {"RGBAPS", "", AVS_CS_RGBAPS, true},
+
+        {"RGB32", "", AVS_CS_BGR32, true},
+        {"RGB64", "", AVS_CS_BGR64, true},
+        {"YUY2", "", AVS_CS_YUY2, false},
     }};
 
     auto it{std::find_if(video_formats.begin(), video_formats.end(),
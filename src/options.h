@@ -0,0 +1,106 @@
+#pragma once
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "params.h"
+
+// The filter_params arguments of one libplacebo_Render instance, independent of AviSynth+. Clip arguments are not part of it.
+class filter_options
+{
+public:
+    using value = std::variant<bool, int, double, std::string>;
+
+    filter_options() : values(filter_params.size())
+    {
+    }
+
+    // Array parameters (type "x*") take every value of the argument, the others only the last one.
+    void set(size_t idx, value v)
+    {
+        auto& arg{values[idx]};
+        if (!filter_params[idx].type.ends_with('*'))
+            arg.clear();
+        arg.emplace_back(std::move(v));
+    }
+
+    // The raw values of the argument, empty if it isn't specified.
+    const std::vector<value>& operator[](size_t idx) const noexcept
+    {
+        return values[idx];
+    }
+
+    // Same as avs_helpers::get_opt_arg: int arguments convert to float, strings to std::string_view and const char*
+    // that point into this object.
+    template<typename T>
+    std::optional<T> get(int idx) const
+    {
+        if (idx < 0 || values[idx].empty())
+            return std::nullopt;
+
+        return convert<T>(values[idx].back());
+    }
+
+    template<typename T>
+    std::vector<T> get_array(int idx) const
+    {
+        std::vector<T> out;
+        if (idx < 0)
+            return out;
+
+        for (const auto& v : values[idx])
+        {
+            if (const auto c{convert<T>(v)})
+                out.emplace_back(*c);
+        }
+
+        return out;
+    }
+
+private:
+    template<typename T>
+    static std::optional<T> convert(const value& v)
+    {
+        if constexpr (std::is_same_v<T, std::string>)
+        {
+            if (const auto* s{std::get_if<std::string>(&v)})
+                return *s;
+        }
+        else if constexpr (std::is_same_v<T, std::string_view>)
+        {
+            if (const auto* s{std::get_if<std::string>(&v)})
+                return std::string_view{*s};
+        }
+        else if constexpr (std::is_same_v<T, const char*>)
+        {
+            if (const auto* s{std::get_if<std::string>(&v)})
+                return s->c_str();
+        }
+        else if constexpr (std::is_same_v<T, bool>)
+        {
+            if (const auto* b{std::get_if<bool>(&v)})
+                return *b;
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            if (const auto* i{std::get_if<int>(&v)})
+                return static_cast<T>(*i);
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            if (const auto* d{std::get_if<double>(&v)})
+                return static_cast<T>(*d);
+            if (const auto* i{std::get_if<int>(&v)})
+                return static_cast<T>(*i);
+        }
+
+        return std::nullopt;
+    }
+
+    std::vector<std::vector<value>> values;
+};
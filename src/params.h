@@ -26,8 +26,8 @@ inline constexpr std::array filter_params{
     param_def{"aspect_mode", "s"},
 
     // --- CUSTOM SHADER ---
-    param_def{"custom_shader_path", "s"},
-    param_def{"custom_shader_param", "s"},
+    param_def{"custom_shader_path", "s*"},
+    param_def{"custom_shader_param", "s*"},
 
     // --- SCALER ---
     param_def{"upscaler", "s"},
@@ -201,6 +201,34 @@ inline constexpr std::array filter_params{
     param_def{"device", "i"},
     param_def{"list_devices", "b"},
     param_def{"cache_path", "s"},
+    param_def{"log_level", "s"},
+    param_def{"trace_path", "s"},
+    param_def{"intermediate_precision", "s"},
+    param_def{"ladder", "s"},
+    param_def{"lut_export", "s"},
+    param_def{"overlay_clips", "c*"},
+    param_def{"overlay_x", "i*"},
+    param_def{"overlay_y", "i*"},
+    param_def{"async_transfer", "b"},
+    param_def{"async_compute", "b"},
+    param_def{"queue_count", "i"},
+    param_def{"device_benchmark", "b"},
+    param_def{"scene_detect", "b"},
+    param_def{"scene_threshold", "f"},
+    param_def{"film_grain_table", "s"},
+    param_def{"autocrop", "b"},
+    param_def{"autocrop_threshold", "f"},
+    param_def{"crop_props", "s"},
+};
+
+inline constexpr std::array compare_params{
+    param_def{"clip", "c", false},
+    param_def{"ref", "c", false},
+    param_def{"space", "s"},
+    param_def{"ms_ssim", "b"},
+    param_def{"log_path", "s"},
+    param_def{"device", "i"},
+    param_def{"cache_path", "s"},
 };
 
 template<size_t N>
@@ -213,12 +241,12 @@ struct string_literal
     char value[N];
 };
 
-template<string_literal Name>
+template<string_literal Name, const auto& Params = filter_params>
 consteval int get_param_idx() noexcept
 {
-    for (int i{0}; i < static_cast<int>(filter_params.size()); ++i)
+    for (int i{0}; i < static_cast<int>(Params.size()); ++i)
     {
-        if (filter_params[i].name == Name.value)
+        if (Params[i].name == Name.value)
             return i;
     }
     return -1;
@@ -47,6 +47,7 @@ const char* AVSC_CC avisynth_c_plugin_init(AVS_ScriptEnvironment* env)
         "avs_check_version",
         "avs_get_env_property",
         "avs_get_parity",
+        "avs_make_property_writable",
     };
     static constexpr std::span<const std::string_view> required_functions{required_functions_storage};
 
@@ -56,18 +57,25 @@ const char* AVSC_CC avisynth_c_plugin_init(AVS_ScriptEnvironment* env)
         return avisynth_c_api_loader::get_last_error();
     }
 
-    static std::string avs_signature{};
-    for (const auto& p : filter_params)
-    {
-        if (p.optional)
+    const auto signature{[](const auto& params) {
+        std::string sig;
+        for (const auto& p : params)
         {
-            avs_signature += "[";
-            avs_signature += p.name;
-            avs_signature += "]";
+            if (p.optional)
+            {
+                sig += "[";
+                sig += p.name;
+                sig += "]";
+            }
+            sig += p.type;
         }
-        avs_signature += p.type;
-    }
-    g_avs_api->avs_add_function(env, "libplacebo_Render", avs_signature.c_str(), create_render, 0);
+        return sig;
+    }};
+
+    static const std::string render_signature{signature(filter_params)};
+    static const std::string compare_signature{signature(compare_params)};
+    g_avs_api->avs_add_function(env, "libplacebo_Render", render_signature.c_str(), create_render, 0);
+    g_avs_api->avs_add_function(env, "libplacebo_Compare", compare_signature.c_str(), create_compare, 0);
 
     return "AviSynth+ libplacebo interface";
 }
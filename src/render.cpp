@@ -1,11 +1,12 @@
 #include <algorithm>
 #include <charconv>
+#include <cmath>
 #include <cstring>
-#include <filesystem>
 #include <format>
-#include <fstream>
+#include <map>
 #include <mutex>
 #include <ranges>
+#include <span>
 #include <utility>
 
 #ifdef _WIN32
@@ -14,7 +15,9 @@
 
 #include "libplacebo_render.h"
 #include "mapping.h"
+#include "options.h"
 #include "params.h"
+#include "trace.h"
 
 extern "C" {
 #include "libplacebo/utils/dolbyvision.h"
@@ -69,10 +72,300 @@ namespace
         }
     }
 
+    struct cached_base
+    {
+        int frame_idx{-1};
+        pl_field field{PL_FIELD_NONE};
+        uint64_t last_used{};
+        pl_tex tex{};
+    };
+
+    // Shared by all instances with the same `ladder` name: the device, the source upload cache and the pre-processed
+    // (deinterlaced, debanded, tone mapped) frames at source resolution that every rung is scaled from.
+    struct ladder_group
+    {
+        std::mutex mtx;
+        std::shared_ptr<priv> vf;
+
+        static constexpr size_t CACHE_SIZE{4};
+        std::array<cached_base, CACHE_SIZE> base;
+        uint64_t timer{};
+        pl_fmt base_fmt{};
+
+        // Set by the instance that creates the group; the others must be created on the same source clip and device, with
+        // the same options for the shared pass.
+        const void* source{};
+        AVS_VideoInfo vi{};
+        int device{};
+        filter_options options;
+
+        // Set by the first instance, checked against the others.
+        bool configured{};
+        pl_rect2df src_crop{};
+        pl_color_space dst_color{};
+        int field{};
+
+        ~ladder_group()
+        {
+            if (vf && vf->vk)
+            {
+                for (auto& entry : base)
+                    pl_tex_destroy(vf->vk->gpu, &entry.tex);
+            }
+        }
+    };
+
+    struct ladder_rung
+    {
+        std::shared_ptr<ladder_group> group;
+        pl_renderer_ptr rr;
+        std::array<pl_tex, 4> tex_out{};
+
+        std::unique_ptr<pl_render_params> base_data;
+        std::unique_ptr<pl_render_params> rung_data;
+
+        ~ladder_rung()
+        {
+            for (auto& tex : tex_out)
+                pl_tex_destroy(group->vf->vk->gpu, &tex);
+        }
+    };
+
+    std::mutex ladder_registry_mtx;
+    std::map<std::string, std::weak_ptr<ladder_group>, std::less<>> ladder_registry;
+
+    // Arguments that only apply to the rung itself, besides the upscaler*, downscaler* and dither* ones. The destination color
+    // space is compared after it's resolved; the device and queue options are taken from the instance that creates the group.
+    // log_level is not one of them: it sets the level of the group's shared pl_log.
+    constexpr auto ladder_rung_params{std::to_array<std::string_view>({"clip", "width", "height", "aspect_mode", "linear_scaling",
+        "sigmoid", "sigmoid_center", "sigmoid_slope", "dst_csp", "dst_matrix", "dst_trc", "dst_prim", "dst_levels", "dst_alpha",
+        "dst_cplace", "dst_max", "dst_min", "error_diffusion_k", "out_fmt", "border", "border_color", "background_transparency",
+        "blur_radius", "corner_rounding", "overlay_clips", "overlay_x", "overlay_y", "ladder", "scene_detect", "scene_threshold",
+        "autocrop", "autocrop_threshold", "device", "list_devices", "device_benchmark", "async_transfer", "async_compute",
+        "queue_count", "cache_path", "trace_path"})};
+
+    // Whether two instances configure the shared pass of a ladder the same way.
+    bool same_ladder_options(const filter_options& a, const filter_options& b)
+    {
+        for (size_t i{0}; i < filter_params.size(); ++i)
+        {
+            const std::string_view name{filter_params[i].name};
+            if (name.starts_with("upscaler") || name.starts_with("downscaler") || name.starts_with("dither") ||
+                std::ranges::find(ladder_rung_params, name) != ladder_rung_params.end())
+                continue;
+
+            if (a[i] != b[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    // AviSynth+ has already checked the argument types against filter_params.
+    filter_options options_from_args(AVS_Value args)
+    {
+        filter_options opts;
+        for (size_t i{0}; i < filter_params.size(); ++i)
+        {
+            const char type{filter_params[i].type[0]};
+            const AVS_Value arg{avs_array_elt(args, static_cast<int>(i))};
+            if (type == 'c' || !avs_defined(arg))
+                continue;
+
+            const int num{(avs_is_array(arg)) ? avs_array_size(arg) : 1};
+            for (int j{0}; j < num; ++j)
+            {
+                const AVS_Value v{(avs_is_array(arg)) ? avs_array_elt(arg, j) : arg};
+                if (type == 'b')
+                    opts.set(i, static_cast<bool>(avs_as_bool(v)));
+                else if (type == 'i')
+                    opts.set(i, avs_as_int(v));
+                else if (type == 'f')
+                    opts.set(i, avs_as_float(v));
+                else
+                    opts.set(i, std::string{avs_as_string(v)});
+            }
+        }
+
+        return opts;
+    }
+
+    // Packed RGB32/RGB64 clip composited onto the output by the renderer.
+    struct overlay_source
+    {
+        pl_gpu gpu;
+        avs_helpers::avs_clip_ptr clip;
+        int num_frames;
+        int comp_size;
+        pl_rect2df dst;
+        pl_tex tex{};
+
+        ~overlay_source()
+        {
+            pl_tex_destroy(gpu, &tex);
+        }
+    };
+
+    // A custom shader //!PARAM whose value is taken from a frame property.
+    struct shader_prop_binding
+    {
+        const pl_hook_par* par;
+        std::string prop;
+    };
+
+    // Downsampled luma of recent source frames. Frames are compared on the GPU; only the mean difference is read back.
+    struct scene_analysis
+    {
+        struct thumbnail
+        {
+            int frame_idx{-1};
+            uint64_t last_used{};
+            pl_tex tex{};
+            // Mean absolute luma difference to frame_idx - 1 (negative: not measured yet).
+            float diff_prev{-1.0f};
+        };
+
+        pl_gpu gpu;
+        int plane;           // source plane used as luma (G for RGB)
+        std::string swizzle; // moves the luma channel of a packed source plane to the first one, empty if already there
+        int num_frames;      // of the source clip
+        float threshold;     // _SceneChange* threshold
+        float luma_scale;    // normalizes samples stored in a wider container (e.g. 10-bit in 16-bit)
+
+        std::vector<pl_tex> downscale; // halving chain from the luma plane towards the thumbnail size
+        std::vector<pl_tex> reduce;    // difference at thumbnail size, halved down to 1x1
+        std::array<thumbnail, 4> thumbs{};
+        uint64_t timer{};
+
+        ~scene_analysis()
+        {
+            for (auto& tex : downscale)
+                pl_tex_destroy(gpu, &tex);
+            for (auto& tex : reduce)
+                pl_tex_destroy(gpu, &tex);
+            for (auto& entry : thumbs)
+                pl_tex_destroy(gpu, &entry.tex);
+        }
+    };
+
+    struct autocrop_analysis
+    {
+        pl_gpu gpu;
+        int plane;             // source plane used as luma (G for RGB)
+        std::string rows_body; // row and column profile shaders, reading the luma channel of the plane
+        std::string cols_body;
+        bool flipped;          // packed RGB is stored bottom-up
+        float threshold;       // mean luma above black from which a row or column is picture
+        float luma_scale;      // normalizes samples stored in a wider container (e.g. 10-bit in 16-bit)
+
+        pl_tex rows{};   // mean luma of every row (1 x height)
+        pl_tex cols{};   // mean luma of every column (width x 1)
+        pl_tex bounds{}; // first/last picture column and row (1x1)
+
+        // Union of the picture areas since the start of the scene, in linear access.
+        int scene_n{-1};
+        bool scene_valid{};
+        std::array<int, 4> scene_crop{};
+
+        ~autocrop_analysis()
+        {
+            pl_tex_destroy(gpu, &rows);
+            pl_tex_destroy(gpu, &cols);
+            pl_tex_destroy(gpu, &bounds);
+        }
+    };
+
+    // YUY2 output: the planar 4:2:2 render is interleaved into one texture (Y0 U Y1 V per texel) for the download.
+    struct yuy2_target
+    {
+        pl_gpu gpu;
+        pl_tex tex{};
+
+        ~yuy2_target()
+        {
+            pl_tex_destroy(gpu, &tex);
+        }
+    };
+
+    // GPU time of the uploads or downloads for the trace. pl_timer returns the results frames later and in submission order, so
+    // the submit time and frame of every measured transfer wait in `pending` until collect() pairs them with their result.
+    struct transfer_timer
+    {
+        struct submission
+        {
+            int64_t ts;
+            int frame;
+        };
+
+        pl_gpu gpu;
+        pl_timer timer{};
+        const char* name{};
+        std::array<submission, 32> pending{};
+        size_t head{}; // oldest submission without a result
+        size_t count{};
+
+        void submitted(int64_t ts, int frame) noexcept
+        {
+            // libplacebo drops the oldest results when its queue is full, the oldest submission goes with them.
+            if (count == pending.size())
+            {
+                head = (head + 1) % pending.size();
+                --count;
+            }
+
+            pending[(head + count) % pending.size()] = {ts, frame};
+            ++count;
+        }
+
+        void collect(tracer& trace) noexcept
+        {
+            for (uint64_t ns{pl_timer_query(gpu, timer)}; ns; ns = pl_timer_query(gpu, timer))
+            {
+                if (!count)
+                    continue;
+
+                trace.gpu_transfer(name, pending[head].ts, ns, pending[head].frame);
+                head = (head + 1) % pending.size();
+                --count;
+            }
+        }
+
+        ~transfer_timer()
+        {
+            pl_timer_destroy(gpu, &timer);
+        }
+    };
+
+    // Luma-only output of a YCbCr source: while the source and destination colors match, the output luma depends only on the
+    // source luma, so the chroma planes aren't uploaded and a neutral 1x1 chroma plane stands in for them.
+    struct neutral_chroma
+    {
+        pl_gpu gpu;
+        pl_tex tex{};
+        pl_plane plane{};
+        pl_plane source_plane{}; // the first chroma plane of src_frame
+        int num_planes;          // src_frame.num_planes with the source chroma
+
+        ~neutral_chroma()
+        {
+            pl_tex_destroy(gpu, &tex);
+        }
+    };
+
+    // The source frames next to the current one, for deinterlacing and scene analysis. They are fetched before the render lock
+    // is taken: the child can be another instance that takes the same lock.
+    struct source_neighbours
+    {
+        avs_helpers::avs_video_frame_ptr prev;
+        avs_helpers::avs_video_frame_ptr next;
+        int prev_n;
+        int next_n;
+    };
+
     struct render_context
     {
         std::mutex mtx;
-        std::unique_ptr<priv> vf;
+        std::shared_ptr<priv> vf;
 
         std::unique_ptr<pl_filter_config> upscaler_config;
         std::unique_ptr<pl_filter_config> downscaler_config;
@@ -90,16 +383,24 @@ namespace
 
         std::unique_ptr<pl_render_params> render_data;
 
-        pl_hook_ptr shader;
-        std::array<const pl_hook*, 1> shader_hooks;
-        pl_custom_lut_ptr lut_ptr;
+        std::vector<pl_hook_ptr> shaders;
+        std::vector<const pl_hook*> shader_hooks;
+        std::vector<shader_prop_binding> shader_prop_params;
+
+        std::vector<std::unique_ptr<overlay_source>> overlay_sources;
+        std::vector<pl_overlay> overlays;
+        std::vector<pl_overlay_part> overlay_parts;
+        std::shared_ptr<const pl_custom_lut> lut_ptr;
+        std::shared_ptr<const grain_table> grain;
+        unsigned grain_fps_num; // source frame rate, the table is indexed by time
+        unsigned grain_fps_den;
         std::unique_ptr<pl_dovi_metadata> dovi_meta;
 
         pl_chroma_location src_cplace;
         pl_chroma_location dst_cplace;
         int src_num_planes;
         int dst_num_planes;
-        std::array<int, 4> src_planes;
+        std::array<plane_upload, 4> src_layout;
         std::array<int, 4> dst_planes;
         int src_comp_size;
 
@@ -115,17 +416,202 @@ namespace
         bool is_src_hdr_min_luma_def;
 
         int field;
-
-        std::filesystem::path cache_path;
-        uint64_t cache_signature;
+        int src_last_frame;
+
+        // Frame props of the output that don't change per frame, resolved in create_render (-1: delete, -2: leave as is).
+        int64_t out_range;
+        int64_t out_matrix;
+        int64_t out_cplace;
+
+        // Source/destination color spaces after the previous pl_color_space_infer_map().
+        bool has_prev_color;
+        pl_color_space prev_src_color;
+        pl_color_space prev_dst_color;
+
+        std::unique_ptr<ladder_rung> ladder;
+        std::shared_ptr<tracer> trace;
+        std::unique_ptr<transfer_timer> upload_timer; // null without trace_path or pl_timer support
+        std::unique_ptr<transfer_timer> download_timer;
+        std::unique_ptr<scene_analysis> scene;
+        std::unique_ptr<autocrop_analysis> autocrop;
+        std::unique_ptr<yuy2_target> yuy2_out;
+        std::unique_ptr<neutral_chroma> luma_only;
+
+        // Per-frame source crop from the <crop_props>Left/Top/Right/Bottom frame props; static_crop without them.
+        std::array<std::string, 4> crop_keys;
+        pl_rect2df static_crop;
+        int aspect_mode; // dst_frame.crop follows the source crop unless 0 (stretch)
+        bool src_flipped;
+        bool dst_flipped;
+        int src_upload_planes; // planes uploaded for the current frame: src_num_planes, or 1 for luma only
     };
 
-    int fix_chroma_offset(render_context* d, pl_tex source, pl_tex target, bool is_input) noexcept
+    void trace_info_cb(void* priv, const pl_render_info* info) noexcept
     {
-        const auto& vf{d->vf};
-        const auto& gpu{vf->vk->gpu};
+        const auto& shader{info->pass->shader};
+        static_cast<tracer*>(priv)->gpu_pass((shader && shader->description) ? shader->description : "pass", info->pass->last);
+    }
+
+    // Generating the shader makes libplacebo build the dither LUT and store it in the device's shared pl_cache.
+    // The renderers of all instances on the device then load it from there instead of generating it again.
+    void warm_dither_cache(const priv& vf, const pl_dither_params& dither) noexcept
+    {
+        if (dither.method != PL_DITHER_BLUE_NOISE && dither.method != PL_DITHER_ORDERED_LUT)
+            return;
 
-        pl_shader sh{pl_dispatch_begin(vf->dp.get())};
+        pl_shader sh{pl_dispatch_begin(vf.dp.get())};
+        pl_shader_obj state{};
+        pl_shader_dither(sh, 8, &state, &dither);
+        pl_dispatch_abort(vf.dp.get(), &sh);
+        pl_shader_obj_destroy(&state);
+    }
+
+    // Only the parameter storage is written; libplacebo uploads it as a uniform, so no shader is regenerated.
+    void update_shader_params(render_context* AVS_RESTRICT d, const AVS_Map* AVS_RESTRICT props, AVS_ScriptEnvironment* env) noexcept
+    {
+        for (const auto& binding : d->shader_prop_params)
+        {
+            const auto& par{*binding.par};
+            int err;
+            double val{g_avs_api->avs_prop_get_float(env, props, binding.prop.c_str(), 0, &err)};
+            if (err)
+                val = static_cast<double>(g_avs_api->avs_prop_get_int(env, props, binding.prop.c_str(), 0, &err));
+            if (err)
+            {
+                *par.data = par.initial;
+                continue;
+            }
+
+            switch (par.type)
+            {
+                case PL_VAR_SINT:
+                    par.data->i = static_cast<int>(std::clamp<double>(std::round(val), par.minimum.i, par.maximum.i));
+                    break;
+                case PL_VAR_UINT:
+                    par.data->u = static_cast<unsigned>(std::clamp<double>(std::round(val), par.minimum.u, par.maximum.u));
+                    break;
+                default:
+                    par.data->f = std::clamp(static_cast<float>(val), par.minimum.f, par.maximum.f);
+                    break;
+            }
+        }
+    }
+
+    // Packed RGB is stored bottom-up; the vertically flipped crop (an empty crop is the whole frame) mirrors it.
+    void flip_crop(pl_rect2df& crop, float w, float h) noexcept
+    {
+        if (crop.x0 == crop.x1 || crop.y0 == crop.y1)
+            crop = {0.0f, 0.0f, w, h};
+
+        crop.y0 = h - crop.y0;
+        crop.y1 = h - crop.y1;
+    }
+
+    // Target rectangle of the source crop `src` in a dst_w x dst_h frame (1: fit, 2: fill). Empty (the whole frame) if `src` is.
+    pl_rect2df aspect_rect(const pl_rect2df& src, int aspect_mode, float dst_w, float dst_h) noexcept
+    {
+        const float src_w_eff{std::abs(src.x1 - src.x0)};
+        const float src_h_eff{std::abs(src.y1 - src.y0)};
+        if (src_w_eff <= 0.0f || src_h_eff <= 0.0f)
+            return {};
+
+        const float scale_x{dst_w / src_w_eff};
+        const float scale_y{dst_h / src_h_eff};
+
+        const float scale{(aspect_mode == 1) ? (std::min)(scale_x, scale_y) : (std::max)(scale_x, scale_y)};
+
+        const float draw_w{src_w_eff * scale};
+        const float draw_h{src_h_eff * scale};
+
+        return {.x0 = (dst_w - draw_w) / 2.0f, .y0 = (dst_h - draw_h) / 2.0f, .x1 = (dst_w + draw_w) / 2.0f, .y1 = (dst_h + draw_h) / 2.0f};
+    }
+
+    // Sets the source crop (and the aspect mode target) of the frame from its crop props. False if they are out of range.
+    bool update_crop(render_context* AVS_RESTRICT d, AVS_FilterInfo* AVS_RESTRICT fi, const AVS_Map* props) noexcept
+    {
+        const auto& env{fi->env};
+        std::array<float, 4> v{};
+        bool has_props{true};
+        for (size_t i{0}; i < v.size() && has_props; ++i)
+        {
+            const char* key{d->crop_keys[i].c_str()};
+            int err;
+            if (const int64_t val{g_avs_api->avs_prop_get_int(env, props, key, 0, &err)}; !err)
+                v[i] = static_cast<float>(val);
+            else if (const double val_f{g_avs_api->avs_prop_get_float(env, props, key, 0, &err)}; !err)
+                v[i] = static_cast<float>(val_f);
+            else
+                has_props = false;
+        }
+
+        const AVS_VideoInfo* src_vi{g_avs_api->avs_get_video_info(fi->child)};
+        const float src_w{static_cast<float>(src_vi->width)};
+        const float src_h{static_cast<float>(src_vi->height)};
+
+        pl_rect2df crop{d->static_crop};
+        if (has_props)
+        {
+            if (v[0] < 0.0f || v[1] < 0.0f || v[2] < 0.0f || v[3] < 0.0f || v[0] + v[2] >= src_w || v[1] + v[3] >= src_h)
+                return false;
+
+            crop = {v[0], v[1], src_w - v[2], src_h - v[3]};
+        }
+
+        auto& src_crop{d->src_frame.crop};
+        src_crop = crop;
+        if (d->src_flipped)
+            flip_crop(src_crop, src_w, src_h);
+
+        if (d->aspect_mode)
+        {
+            const float dst_w{static_cast<float>(fi->vi.width)};
+            const float dst_h{static_cast<float>(fi->vi.height)};
+            auto& dst_crop{d->dst_frame.crop};
+            dst_crop = aspect_rect(crop, d->aspect_mode, dst_w, dst_h);
+            if (d->dst_flipped)
+                flip_crop(dst_crop, dst_w, dst_h);
+        }
+
+        return true;
+    }
+
+    int upload_overlays(render_context* AVS_RESTRICT d, std::span<const avs_helpers::avs_video_frame_ptr> frames) noexcept
+    {
+        const auto& gpu{d->vf->vk->gpu};
+        for (size_t i{0}; i < frames.size(); ++i)
+        {
+            auto& ov{*d->overlay_sources[i]};
+            AVS_VideoFrame* frame{frames[i].get()};
+            const int comp_size{ov.comp_size};
+            const int width{g_avs_api->avs_get_row_size_p(frame, AVS_DEFAULT_PLANE) / (comp_size * 4)};
+            const int height{g_avs_api->avs_get_height_p(frame, AVS_DEFAULT_PLANE)};
+
+            // BGRA
+            const pl_plane_data data{
+                .type = PL_FMT_UNORM,
+                .width = width,
+                .height = height,
+                .component_size = {comp_size * 8, comp_size * 8, comp_size * 8, comp_size * 8},
+                .component_map = {2, 1, 0, 3},
+                .pixel_stride = static_cast<size_t>(comp_size) * 4,
+                .row_stride = static_cast<size_t>(g_avs_api->avs_get_pitch_p(frame, AVS_DEFAULT_PLANE)),
+                .pixels = g_avs_api->avs_get_read_ptr_p(frame, AVS_DEFAULT_PLANE),
+            };
+
+            if (!pl_upload_plane(gpu, nullptr, &ov.tex, &data))
+                return -1;
+
+            d->overlays[i].tex = ov.tex;
+            // Packed RGB is stored bottom-up.
+            d->overlay_parts[i].src = {0.0f, static_cast<float>(height), static_cast<float>(width), 0.0f};
+        }
+
+        return 0;
+    }
+
+    int fix_chroma_offset(const priv& vf, pl_tex source, pl_tex target, bool is_input) noexcept
+    {
+        pl_shader sh{pl_dispatch_begin(vf.dp.get())};
         const pl_sample_src sample{.tex = source};
         pl_shader_sample_direct(sh, &sample);
 
@@ -142,7 +628,38 @@ namespace
             .target = target,
         };
 
-        if (!pl_dispatch_finish(vf->dp.get(), &params))
+        if (!pl_dispatch_finish(vf.dp.get(), &params))
+            return -1;
+
+        return 0;
+    }
+
+    int pack_yuy2(const priv& vf, const std::array<pl_tex, 4>& planes, pl_tex target) noexcept
+    {
+        pl_shader sh{pl_dispatch_begin(vf.dp.get())};
+        const std::array<pl_shader_desc, 3> descs{{
+            {.desc = {.name = "y_plane", .type = PL_DESC_SAMPLED_TEX}, .binding = {.object = planes[0]}},
+            {.desc = {.name = "u_plane", .type = PL_DESC_SAMPLED_TEX}, .binding = {.object = planes[1]}},
+            {.desc = {.name = "v_plane", .type = PL_DESC_SAMPLED_TEX}, .binding = {.object = planes[2]}},
+        }};
+        const pl_custom_shader custom{
+            .description = "Pack YUY2",
+            .body = "ivec2 p = ivec2(gl_FragCoord.xy);"
+                    "ivec2 l = ivec2(p.x * 2, p.y);"
+                    "color = vec4(texelFetch(y_plane, l, 0).r, texelFetch(u_plane, p, 0).r,"
+                    "             texelFetch(y_plane, l + ivec2(1, 0), 0).r, texelFetch(v_plane, p, 0).r);",
+            .output = PL_SHADER_SIG_COLOR,
+            .descriptors = descs.data(),
+            .num_descriptors = static_cast<int>(descs.size()),
+        };
+        pl_shader_custom(sh, &custom);
+
+        const pl_dispatch_params params{
+            .shader = &sh,
+            .target = target,
+        };
+
+        if (!pl_dispatch_finish(vf.dp.get(), &params))
             return -1;
 
         return 0;
@@ -151,24 +668,26 @@ namespace
     const std::array<pl_tex, 4>* get_cached_planes(render_context* AVS_RESTRICT d, AVS_VideoFrame* AVS_RESTRICT src, int n) noexcept
     {
         const auto& vf{d->vf};
-        const auto& gpu{vf->vk->gpu};
         auto& cache{vf->cache};
         vf->timer++;
 
+        const int num_planes{d->src_upload_planes};
         for (auto& entry : cache)
         {
-            if (entry.frame_idx == n)
+            if (entry.frame_idx == n && entry.num_planes >= num_planes)
             {
                 entry.last_used = vf->timer;
                 return &entry.planes;
             }
         }
 
-        const size_t active_cache_size{d->deinterlace_data ? vf->CACHE_SIZE : 1};
+        // Scene analysis uploads the next frame ahead of its render.
+        const size_t active_cache_size{(d->deinterlace_data || d->scene) ? vf->CACHE_SIZE : 1};
         cached_frame* lru_entry{&cache[0]};
         for (size_t i{0}; i < active_cache_size; ++i)
         {
-            if (cache[i].frame_idx == -1)
+            // A frame uploaded without the planes needed now is uploaded again in its place.
+            if (cache[i].frame_idx == -1 || cache[i].frame_idx == n)
             {
                 lru_entry = &vf->cache[i];
                 break;
@@ -177,89 +696,54 @@ namespace
                 lru_entry = &vf->cache[i];
         }
 
-        const int src_comp_size{d->src_comp_size};
-        const int src_comp_bits{src_comp_size * 8};
-        const auto& src_fmt_type{d->src_fmt_type};
-        const auto& src_planes{d->src_planes};
+        const trace_scope upload_span(d->trace.get(), "upload", n);
+        const auto& upload_timer{d->upload_timer};
+        const int64_t upload_begin{(upload_timer) ? tracer::now_us() : 0};
 
-        for (int i{0}; i < d->src_num_planes; ++i)
-        {
-            const int plane{src_planes[i]};
-            const pl_plane_data source{
-                .type = src_fmt_type,
-                .width = g_avs_api->avs_get_row_size_p(src, plane) / src_comp_size,
-                .height = g_avs_api->avs_get_height_p(src, plane),
-                .component_size = {src_comp_bits},
-                .component_map = {i},
-                .pixel_stride = static_cast<size_t>(src_comp_size),
-                .row_stride = static_cast<size_t>(g_avs_api->avs_get_pitch_p(src, plane)),
-                .pixels = g_avs_api->avs_get_read_ptr_p(src, plane),
-            };
-
-            if (!pl_upload_plane(gpu, NULL, &lru_entry->planes[i], &source))
-                return nullptr;
-
-            if (src_fmt_type == PL_FMT_FLOAT && (plane == AVS_PLANAR_U || plane == AVS_PLANAR_V))
-            {
-                pl_tex_params t_fix{lru_entry->planes[i]->params};
-                t_fix.renderable = true;
-                t_fix.host_writable = false;
-
-                auto& fix_fbo_in{vf->fix_fbo_in};
-                if (!pl_tex_recreate(gpu, &fix_fbo_in, &t_fix))
-                    return nullptr;
-                if (fix_chroma_offset(d, lru_entry->planes[i], fix_fbo_in, true))
-                    return nullptr;
+        if (!upload_planes(*vf, src, std::span{d->src_layout}.first(num_planes), lru_entry->planes,
+                (upload_timer) ? upload_timer->timer : nullptr))
+            return nullptr;
 
-                std::swap(lru_entry->planes[i], fix_fbo_in);
-            }
+        if (upload_timer)
+        {
+            for (int i{0}; i < num_planes; ++i)
+                upload_timer->submitted(upload_begin, n);
         }
 
         lru_entry->frame_idx = n;
+        lru_entry->num_planes = num_planes;
         lru_entry->last_used = vf->timer;
         return &lru_entry->planes;
     }
 
-    int render_filter(AVS_VideoFrame* AVS_RESTRICT dst, AVS_VideoFrame* AVS_RESTRICT src, int n, render_context* AVS_RESTRICT d,
-        AVS_FilterInfo* AVS_RESTRICT fi) noexcept
+    int prepare_source(AVS_VideoFrame* AVS_RESTRICT src, int n, const source_neighbours& nb, render_context* AVS_RESTRICT d,
+        pl_frame& f_prev, pl_frame& f_next) noexcept
     {
-        const int src_num_planes{d->src_num_planes};
-
-        const auto& vf{d->vf};
-        const auto& gpu{vf->vk->gpu};
-
         const auto textures_curr{get_cached_planes(d, src, n)};
         if (!textures_curr)
             return -1;
 
         auto& src_frame{d->src_frame};
         auto& src_planes{src_frame.planes};
-        for (int i{0}; i < d->src_num_planes; ++i)
+        for (int i{0}; i < d->src_upload_planes; ++i)
             src_planes[i].texture = (*textures_curr)[i];
 
         pl_frame_set_chroma_location(&src_frame, d->src_cplace);
 
-        pl_frame f_prev;
-        pl_frame f_next;
+        src_frame.prev = nullptr;
+        src_frame.next = nullptr;
 
         if (d->deinterlace_data)
         {
-            const int max_f{fi->vi.num_frames - 1};
-            const int max_p{(std::max)(0, n - 1)};
-            const int max_n{(std::min)(max_f, n + 1)};
-
-            const auto p_ptr{avs_helpers::avs_video_frame_ptr{g_avs_api->avs_get_frame(fi->child, max_p)}};
-            auto n_ptr{avs_helpers::avs_video_frame_ptr{g_avs_api->avs_get_frame(fi->child, max_n)}};
-
-            auto tex_prev{get_cached_planes(d, p_ptr.get(), max_p)};
-            auto tex_next{get_cached_planes(d, n_ptr.get(), max_n)};
+            auto tex_prev{get_cached_planes(d, nb.prev.get(), nb.prev_n)};
+            auto tex_next{get_cached_planes(d, nb.next.get(), nb.next_n)};
 
             if (tex_prev && tex_next)
             {
                 f_prev = src_frame;
                 f_next = src_frame;
 
-                for (int i{0}; i < d->src_num_planes; ++i)
+                for (int i{0}; i < d->src_upload_planes; ++i)
                 {
                     f_prev.planes[i].texture = (*tex_prev)[i];
                     f_next.planes[i].texture = (*tex_next)[i];
@@ -270,19 +754,420 @@ namespace
             }
         }
 
+        return 0;
+    }
+
+    // Texture plane and channel of the source luma: Y, or G for RGB.
+    std::pair<int, int> luma_channel(const pl_frame& frame, bool is_rgb) noexcept
+    {
+        const int luma{(is_rgb) ? PL_CHANNEL_G : PL_CHANNEL_Y};
+        for (int i{0}; i < frame.num_planes; ++i)
+        {
+            for (int c{0}; c < frame.planes[i].components; ++c)
+            {
+                if (frame.planes[i].component_mapping[c] == luma)
+                    return {i, c};
+            }
+        }
+
+        return {0, 0};
+    }
+
+    bool scene_pass(pl_dispatch dp, pl_tex src, pl_tex dst, const char* swizzle) noexcept
+    {
+        // Bilinear sampling between the texels of a halved texture averages 2x2 blocks.
+        pl_shader sh{pl_dispatch_begin(dp)};
+        const pl_sample_src sample{
+            .tex = src,
+            .components = (swizzle) ? 0 : 1,
+            .new_w = dst->params.w,
+            .new_h = dst->params.h,
+            .sample_mode = (src->params.format->caps & PL_FMT_CAP_LINEAR) ? PL_TEX_SAMPLE_LINEAR : PL_TEX_SAMPLE_NEAREST,
+        };
+        pl_shader_sample_direct(sh, &sample);
+
+        if (swizzle)
+        {
+            const pl_custom_shader custom{
+                .description = "Scene analysis luma",
+                .body = swizzle,
+                .input = PL_SHADER_SIG_COLOR,
+                .output = PL_SHADER_SIG_COLOR,
+            };
+            pl_shader_custom(sh, &custom);
+        }
+
+        const pl_dispatch_params params{
+            .shader = &sh,
+            .target = dst,
+        };
+
+        return pl_dispatch_finish(dp, &params);
+    }
+
+    scene_analysis::thumbnail* get_thumbnail(render_context* AVS_RESTRICT d, int n, AVS_VideoFrame* AVS_RESTRICT frame) noexcept
+    {
+        auto& scene{*d->scene};
+        scene.timer++;
+
+        for (auto& entry : scene.thumbs)
+        {
+            if (entry.frame_idx == n)
+            {
+                entry.last_used = scene.timer;
+                return &entry;
+            }
+        }
+
+        auto* lru_entry{&scene.thumbs[0]};
+        for (auto& entry : scene.thumbs)
+        {
+            if (entry.last_used < lru_entry->last_used)
+                lru_entry = &entry;
+        }
+
+        const auto planes{get_cached_planes(d, frame, n)};
+        if (!planes)
+            return nullptr;
+
+        const trace_scope span(d->trace.get(), "scene analysis", n);
+
+        const auto& dp{d->vf->dp};
+        pl_tex src{(*planes)[scene.plane]};
+        const char* swizzle{(scene.swizzle.empty()) ? nullptr : scene.swizzle.c_str()};
+        for (pl_tex level : scene.downscale)
+        {
+            if (!scene_pass(dp.get(), src, level, swizzle))
+                return nullptr;
+            src = level;
+            swizzle = nullptr;
+        }
+
+        if (!scene_pass(dp.get(), src, lru_entry->tex, swizzle))
+            return nullptr;
+
+        lru_entry->frame_idx = n;
+        lru_entry->last_used = scene.timer;
+        lru_entry->diff_prev = -1.0f;
+        return lru_entry;
+    }
+
+    // Mean absolute luma difference between the source frames n - 1 and n, in [0, 1]. Negative on error.
+    float frame_difference(
+        render_context* AVS_RESTRICT d, int n, AVS_VideoFrame* AVS_RESTRICT frame, AVS_VideoFrame* AVS_RESTRICT prev_frame) noexcept
+    {
+        auto* cur{get_thumbnail(d, n, frame)};
+        if (!cur)
+            return -1.0f;
+        if (cur->diff_prev >= 0.0f)
+            return cur->diff_prev;
+
+        const auto* prev{get_thumbnail(d, n - 1, prev_frame)};
+        if (!prev)
+            return -1.0f;
+
+        auto& scene{*d->scene};
+        const auto& dp{d->vf->dp};
+
+        {
+            pl_shader sh{pl_dispatch_begin(dp.get())};
+            const std::array<pl_shader_desc, 2> descs{{
+                {.desc = {.name = "cur", .type = PL_DESC_SAMPLED_TEX}, .binding = {.object = cur->tex}},
+                {.desc = {.name = "prev", .type = PL_DESC_SAMPLED_TEX}, .binding = {.object = prev->tex}},
+            }};
+            const pl_custom_shader custom{
+                .description = "Scene analysis difference",
+                .body = "ivec2 p = ivec2(gl_FragCoord.xy);"
+                        "color = vec4(abs(texelFetch(cur, p, 0).r - texelFetch(prev, p, 0).r));",
+                .output = PL_SHADER_SIG_COLOR,
+                .descriptors = descs.data(),
+                .num_descriptors = static_cast<int>(descs.size()),
+            };
+            pl_shader_custom(sh, &custom);
+
+            const pl_dispatch_params params{
+                .shader = &sh,
+                .target = scene.reduce[0],
+            };
+
+            if (!pl_dispatch_finish(dp.get(), &params))
+                return -1.0f;
+        }
+
+        for (size_t i{1}; i < scene.reduce.size(); ++i)
+        {
+            if (!scene_pass(dp.get(), scene.reduce[i - 1], scene.reduce[i], nullptr))
+                return -1.0f;
+        }
+
+        const pl_tex result{scene.reduce.back()};
+        std::array<std::byte, 4> texel{};
+        const pl_tex_transfer_params ttr{
+            .tex = result,
+            .ptr = texel.data(),
+        };
+
+        if (!pl_tex_download(d->vf->vk->gpu, &ttr))
+            return -1.0f;
+
+        float diff;
+        if (result->params.format->type == PL_FMT_FLOAT)
+        {
+            std::memcpy(&diff, texel.data(), sizeof(float));
+        }
+        else
+        {
+            uint16_t v;
+            std::memcpy(&v, texel.data(), sizeof(v));
+            diff = v / 65535.0f;
+        }
+
+        cur->diff_prev = std::clamp(diff * scene.luma_scale, 0.0f, 1.0f);
+        return cur->diff_prev;
+    }
+
+    // Black bars of source frame n as left/top/right/bottom crop. 0: picture found, 1: black frame (no crop), -1: error.
+    int detect_crop(render_context* AVS_RESTRICT d, AVS_VideoFrame* AVS_RESTRICT frame, int n, std::array<int, 4>& crop) noexcept
+    {
+        auto& ac{*d->autocrop};
+        const auto planes{get_cached_planes(d, frame, n)};
+        if (!planes)
+            return -1;
+
+        const trace_scope span(d->trace.get(), "autocrop", n);
+
+        const auto& dp{d->vf->dp};
+        const pl_tex src{(*planes)[ac.plane]};
+        const auto profile{[&](pl_tex target, const char* body) {
+            pl_shader sh{pl_dispatch_begin(dp.get())};
+            const pl_shader_desc desc{.desc = {.name = "luma", .type = PL_DESC_SAMPLED_TEX}, .binding = {.object = src}};
+            const pl_custom_shader custom{
+                .description = "Autocrop profile",
+                .body = body,
+                .output = PL_SHADER_SIG_COLOR,
+                .descriptors = &desc,
+                .num_descriptors = 1,
+            };
+            pl_shader_custom(sh, &custom);
+
+            const pl_dispatch_params params{
+                .shader = &sh,
+                .target = target,
+            };
+
+            return pl_dispatch_finish(dp.get(), &params);
+        }};
+
+        if (!profile(ac.rows, ac.rows_body.c_str()) || !profile(ac.cols, ac.cols_body.c_str()))
+            return -1;
+
+        {
+            // Black level plus threshold, in the units of the uploaded texture.
+            const float black{(d->src_frame.repr.levels == PL_COLOR_LEVELS_LIMITED) ? 16.0f / 255.0f : 0.0f};
+            const float thr{(black + ac.threshold) / ac.luma_scale};
+
+            pl_shader sh{pl_dispatch_begin(dp.get())};
+            const std::array<pl_shader_desc, 2> descs{{
+                {.desc = {.name = "rows", .type = PL_DESC_SAMPLED_TEX}, .binding = {.object = ac.rows}},
+                {.desc = {.name = "cols", .type = PL_DESC_SAMPLED_TEX}, .binding = {.object = ac.cols}},
+            }};
+            const pl_shader_var var{.var = pl_var_float("thr"), .data = &thr, .dynamic = true};
+            const pl_custom_shader custom{
+                .description = "Autocrop bounds",
+                .body = "int h = textureSize(rows, 0).y; int w = textureSize(cols, 0).x;"
+                        "int top = h; int bottom = -1; int left = w; int right = -1;"
+                        "for (int y = 0; y < h; ++y) if (texelFetch(rows, ivec2(0, y), 0).r > thr) { top = min(top, y); bottom = y; }"
+                        "for (int x = 0; x < w; ++x) if (texelFetch(cols, ivec2(x, 0), 0).r > thr) { left = min(left, x); right = x; }"
+                        "color = vec4(float(left), float(top), float(right), float(bottom));",
+                .output = PL_SHADER_SIG_COLOR,
+                .descriptors = descs.data(),
+                .num_descriptors = static_cast<int>(descs.size()),
+                .variables = &var,
+                .num_variables = 1,
+            };
+            pl_shader_custom(sh, &custom);
+
+            const pl_dispatch_params params{
+                .shader = &sh,
+                .target = ac.bounds,
+            };
+
+            if (!pl_dispatch_finish(dp.get(), &params))
+                return -1;
+        }
+
+        std::array<float, 4> bounds{};
+        const pl_tex_transfer_params ttr{
+            .tex = ac.bounds,
+            .ptr = bounds.data(),
+        };
+
+        if (!pl_tex_download(d->vf->vk->gpu, &ttr))
+            return -1;
+
+        if (bounds[2] < 0.0f || bounds[3] < 0.0f)
+        {
+            crop = {};
+            return 1;
+        }
+
+        const int w{ac.cols->params.w};
+        const int h{ac.rows->params.h};
+        crop = {static_cast<int>(bounds[0]), static_cast<int>(bounds[1]), w - 1 - static_cast<int>(bounds[2]),
+            h - 1 - static_cast<int>(bounds[3])};
+        if (ac.flipped)
+            std::swap(crop[1], crop[3]);
+
+        return 0;
+    }
+
+    // RGB frame in the destination color space, the hand-off between the shared pass and the rungs.
+    pl_frame ladder_base_frame(pl_tex tex, const render_context* d) noexcept
+    {
+        pl_frame frame{};
+        frame.num_planes = 1;
+        frame.planes[0].texture = tex;
+        frame.planes[0].components = 4;
+        for (int i{0}; i < 4; ++i)
+            frame.planes[0].component_mapping[i] = i;
+        frame.repr = pl_color_repr_rgb;
+        frame.repr.alpha = (d->src_frame.repr.alpha != PL_ALPHA_NONE) ? PL_ALPHA_INDEPENDENT : PL_ALPHA_NONE;
+        frame.color = d->dst_frame.color;
+
+        return frame;
+    }
+
+    // Renders the shared pre-processed frame of a ladder group, or returns the cached one.
+    pl_tex get_ladder_base(AVS_VideoFrame* AVS_RESTRICT src, int n, const source_neighbours& nb, render_context* AVS_RESTRICT d) noexcept
+    {
+        auto& group{*d->ladder->group};
+        const auto& vf{d->vf};
+        const auto& gpu{vf->vk->gpu};
+        const pl_field field{d->src_frame.field};
+        group.timer++;
+
+        for (auto& entry : group.base)
+        {
+            if (entry.frame_idx == n && entry.field == field)
+            {
+                entry.last_used = group.timer;
+                return entry.tex;
+            }
+        }
+
+        cached_base* lru_entry{&group.base[0]};
+        for (auto& entry : group.base)
+        {
+            if (entry.frame_idx == -1)
+            {
+                lru_entry = &entry;
+                break;
+            }
+            if (entry.last_used < lru_entry->last_used)
+                lru_entry = &entry;
+        }
+
+        pl_frame f_prev;
+        pl_frame f_next;
+        if (prepare_source(src, n, nb, d, f_prev, f_next))
+            return nullptr;
+
+        const auto& crop{d->src_frame.crop};
+        const pl_tex_params t_base{
+            .w = static_cast<int>(std::lround(std::abs(crop.x1 - crop.x0))),
+            .h = static_cast<int>(std::lround(std::abs(crop.y1 - crop.y0))),
+            .format = group.base_fmt,
+            .sampleable = true,
+            .renderable = true,
+        };
+
+        lru_entry->frame_idx = -1;
+        if (!pl_tex_recreate(gpu, &lru_entry->tex, &t_base))
+            return nullptr;
+
+        const pl_frame base_frame{ladder_base_frame(lru_entry->tex, d)};
+        const trace_scope render_span(d->trace.get(), "render (ladder base)", n);
+        if (d->trace)
+            d->trace->gpu_begin(tracer::now_us(), n);
+        if (!pl_render_image(vf->rr.get(), &d->src_frame, &base_frame, d->ladder->base_data.get()))
+            return nullptr;
+
+        lru_entry->frame_idx = n;
+        lru_entry->field = field;
+        lru_entry->last_used = group.timer;
+        return lru_entry->tex;
+    }
+
+    int render_filter(AVS_VideoFrame* AVS_RESTRICT dst, AVS_VideoFrame* AVS_RESTRICT src, int n, const source_neighbours& nb,
+        render_context* AVS_RESTRICT d) noexcept
+    {
+        const auto& vf{d->vf};
+        const auto& gpu{vf->vk->gpu};
+        const auto& ladder{d->ladder};
+
         auto& dst_frame{d->dst_frame};
         pl_frame_set_chroma_location(&dst_frame, d->dst_cplace);
 
-        if (!pl_render_image(vf->rr.get(), &src_frame, &dst_frame, d->render_data.get()))
-            return -1;
+        if (ladder)
+        {
+            const pl_tex base{get_ladder_base(src, n, nb, d)};
+            if (!base)
+                return -1;
+
+            const pl_frame base_frame{ladder_base_frame(base, d)};
+            const trace_scope render_span(d->trace.get(), "render", n);
+            if (d->trace)
+                d->trace->gpu_begin(tracer::now_us(), n);
+            if (!pl_render_image(ladder->rr.get(), &base_frame, &dst_frame, ladder->rung_data.get()))
+                return -1;
+        }
+        else
+        {
+            pl_frame f_prev;
+            pl_frame f_next;
+            if (prepare_source(src, n, nb, d, f_prev, f_next))
+                return -1;
+
+            const trace_scope render_span(d->trace.get(), "render", n);
+            if (d->trace)
+                d->trace->gpu_begin(tracer::now_us(), n);
+            if (!pl_render_image(vf->rr.get(), &d->src_frame, &dst_frame, d->render_data.get()))
+                return -1;
+        }
 
         // Download planes
+        const trace_scope download_span(d->trace.get(), "download", n);
+        const auto& download_timer{d->download_timer};
+        const pl_timer timer{(download_timer) ? download_timer->timer : nullptr};
         const auto& dst_planes{d->dst_planes};
+        const auto& tex_outs{ladder ? ladder->tex_out : vf->tex_out};
+
+        if (const auto& yuy2_out{d->yuy2_out})
+        {
+            if (pack_yuy2(*vf, tex_outs, yuy2_out->tex))
+                return -1;
+
+            const pl_tex_transfer_params ttr{
+                .tex = yuy2_out->tex,
+                .row_pitch = static_cast<size_t>(g_avs_api->avs_get_pitch_p(dst, AVS_DEFAULT_PLANE)),
+                .timer = timer,
+                .ptr = g_avs_api->avs_get_write_ptr_p(dst, AVS_DEFAULT_PLANE),
+            };
+
+            const int64_t download_begin{(timer) ? tracer::now_us() : 0};
+            if (!pl_tex_download(gpu, &ttr))
+                return -1;
+            if (timer)
+                download_timer->submitted(download_begin, n);
+
+            return 0;
+        }
+
         const int dst_bit_depth{dst_frame.repr.bits.color_depth};
         for (int i{0}; i < d->dst_num_planes; ++i)
         {
             const int plane{dst_planes[i]};
-            auto& tex_out{vf->tex_out[i]};
+            pl_tex tex_out{tex_outs[i]};
 
             if (dst_bit_depth == 32 && (plane == AVS_PLANAR_U || plane == AVS_PLANAR_V))
             {
@@ -292,20 +1177,25 @@ namespace
                 auto& fix_fbo_out{vf->fix_fbo_out};
                 if (!pl_tex_recreate(gpu, &fix_fbo_out, &t_fix))
                     return -1;
-                if (fix_chroma_offset(d, tex_out, fix_fbo_out, false))
+                if (fix_chroma_offset(*vf, tex_out, fix_fbo_out, false))
                     return -1;
 
-                std::swap(tex_out, fix_fbo_out);
+                // The render target stays bound to dst_frame, download the corrected copy.
+                tex_out = fix_fbo_out;
             }
 
             const pl_tex_transfer_params ttr{
                 .tex = tex_out,
                 .row_pitch = static_cast<size_t>(g_avs_api->avs_get_pitch_p(dst, plane)),
+                .timer = timer,
                 .ptr = g_avs_api->avs_get_write_ptr_p(dst, plane),
             };
 
+            const int64_t download_begin{(timer) ? tracer::now_us() : 0};
             if (!pl_tex_download(gpu, &ttr))
                 return -1;
+            if (timer)
+                download_timer->submitted(download_begin, n);
         }
 
         return 0;
@@ -319,7 +1209,13 @@ namespace
         const int is_double_rate{d->field == -2 || d->field > 1};
         const int src_n{is_double_rate ? (n >> 1) : n};
 
+        tracer* const trace{d->trace.get()};
+        const trace_scope get_frame_span(trace, "GetFrame", n);
+
+        const int64_t child_begin{(trace) ? tracer::now_us() : 0};
         const auto src_ptr{avs_helpers::avs_video_frame_ptr{g_avs_api->avs_get_frame(fi->child, src_n)}};
+        if (trace)
+            trace->cpu_span("child GetFrame", child_begin, tracer::now_us(), n);
         if (!src_ptr)
             return nullptr;
         auto dst_ptr{avs_helpers::avs_video_frame_ptr{g_avs_api->avs_new_video_frame_p(env, &fi->vi, src_ptr.get())}};
@@ -329,7 +1225,38 @@ namespace
             return nullptr;
         }};
 
-        std::scoped_lock lock(d->mtx);
+        source_neighbours nb{};
+        if (d->deinterlace_data || d->scene)
+        {
+            nb.prev_n = (std::max)(0, src_n - 1);
+            nb.next_n = (std::min)(d->src_last_frame, src_n + 1);
+            nb.prev = avs_helpers::avs_video_frame_ptr{g_avs_api->avs_get_frame(fi->child, nb.prev_n)};
+            nb.next = avs_helpers::avs_video_frame_ptr{g_avs_api->avs_get_frame(fi->child, nb.next_n)};
+            if (!nb.prev || !nb.next)
+                return nullptr;
+        }
+
+        std::vector<avs_helpers::avs_video_frame_ptr> overlay_frames;
+        overlay_frames.reserve(d->overlay_sources.size());
+        for (const auto& ov : d->overlay_sources)
+        {
+            overlay_frames.emplace_back(g_avs_api->avs_get_frame(ov->clip.get(), (std::min)(n, ov->num_frames - 1)));
+            if (!overlay_frames.back())
+                return nullptr;
+        }
+
+        const int64_t lock_begin{(trace) ? tracer::now_us() : 0};
+        std::scoped_lock lock(d->ladder ? d->ladder->group->mtx : d->mtx);
+        if (trace)
+        {
+            trace->cpu_span("lock wait", lock_begin, tracer::now_us(), n);
+
+            // Results of the transfers of the previous frames.
+            if (d->upload_timer)
+                d->upload_timer->collect(*trace);
+            if (d->download_timer)
+                d->download_timer->collect(*trace);
+        }
 
         const AVS_Map* props{g_avs_api->avs_get_frame_props_ro(env, src_ptr.get())};
         auto& src_repr{d->src_frame.repr};
@@ -435,42 +1362,133 @@ namespace
                         // As the source image already has a specific black point,
                         // and the RPU isn't necessarily ground truth on the actual coded values
 
-                        // Set target black point to the same as source
-                        if (d->dst_frame.color.transfer == PL_COLOR_TRC_PQ)
-                            d->dst_frame.color.hdr.min_luma = hdr_props.min_luma;
-                        else
-                            hdr_props.min_luma = pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, dm_data->source_min_pq / 4095.0f);
+                        // Set target black point to the same as source
+                        if (d->dst_frame.color.transfer == PL_COLOR_TRC_PQ)
+                            d->dst_frame.color.hdr.min_luma = hdr_props.min_luma;
+                        else
+                            hdr_props.min_luma = pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, dm_data->source_min_pq / 4095.0f);
+
+                        hdr_props.max_luma = pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, dm_data->source_max_pq / 4095.0f);
+                    }
+                }
+            }
+        }
+
+        // Unchanged metadata maps to the same result; skip inferring it again.
+        auto& dst_pl_csp{d->dst_frame.color};
+        if (!d->has_prev_color || !pl_color_space_equal(&src_pl_csp, &d->prev_src_color) ||
+            !pl_color_space_equal(&dst_pl_csp, &d->prev_dst_color))
+        {
+            pl_color_space_infer_map(&src_pl_csp, &dst_pl_csp);
+            d->prev_src_color = src_pl_csp;
+            d->prev_dst_color = dst_pl_csp;
+            d->has_prev_color = true;
+        }
+
+        if (const auto& luma_only{d->luma_only})
+        {
+            // Any color conversion makes the output luma depend on the source chroma.
+            const bool use_neutral{src_repr.sys == d->dst_frame.repr.sys && pl_color_space_equal(&src_pl_csp, &dst_pl_csp) &&
+                                   !pl_color_space_is_hdr(&src_pl_csp)};
+            auto& src_frame{d->src_frame};
+            src_frame.planes[1] = (use_neutral) ? luma_only->plane : luma_only->source_plane;
+            src_frame.num_planes = (use_neutral) ? 2 : luma_only->num_planes;
+            d->src_upload_planes = (use_neutral) ? 1 : d->src_num_planes;
+        }
+
+        update_shader_params(d, props, env);
+
+        if (!d->crop_keys[0].empty() && !update_crop(d, fi, props))
+            return set_err(std::format("libplacebo_Render: frame {}: the crop props are out of range.", src_n));
+
+        if (d->grain)
+            grain_for_frame(*d->grain, src_n, d->grain_fps_num, d->grain_fps_den, d->src_frame.film_grain);
+
+        const uint64_t log_mark{d->vf->log_buffer.mark()};
+        if (!overlay_frames.empty() && upload_overlays(d, overlay_frames))
+            return set_err(std::format("libplacebo_Render: {}", d->vf->log_buffer.collect(log_mark)));
+
+        if (render_filter(dst_ptr.get(), src_ptr.get(), src_n, nb, d))
+            return set_err(std::format("libplacebo_Render: {}", d->vf->log_buffer.collect(log_mark)));
+
+        // The first and last frames count as scene changes.
+        float diff_prev{1.0f};
+        float diff_next{1.0f};
+        if (d->scene)
+        {
+            if (src_n > 0)
+                diff_prev = frame_difference(d, src_n, src_ptr.get(), nb.prev.get());
+            if (src_n < d->scene->num_frames - 1 && diff_prev >= 0.0f)
+                diff_next = frame_difference(d, src_n + 1, nb.next.get(), src_ptr.get());
+            if (diff_prev < 0.0f || diff_next < 0.0f)
+                return set_err(std::format("libplacebo_Render: scene analysis failed. {}", d->vf->log_buffer.collect(log_mark)));
+        }
+
+        std::array<int, 4> crop{};
+        const std::array<int, 4>* scene_crop{};
+        if (const auto& autocrop{d->autocrop})
+        {
+            const int res{detect_crop(d, src_ptr.get(), src_n, crop)};
+            if (res < 0)
+                return set_err(std::format("libplacebo_Render: autocrop failed. {}", d->vf->log_buffer.collect(log_mark)));
+
+            if (d->scene)
+            {
+                // A scene change or a jump in the frame order starts a new aggregate; black frames don't count.
+                if (autocrop->scene_n < 0 ||
+                    (src_n != autocrop->scene_n && (src_n != autocrop->scene_n + 1 || diff_prev >= d->scene->threshold)))
+                    autocrop->scene_valid = false;
+
+                if (res == 0)
+                {
+                    auto& agg{autocrop->scene_crop};
+                    for (size_t i{0}; i < agg.size(); ++i)
+                        agg[i] = (autocrop->scene_valid) ? (std::min)(agg[i], crop[i]) : crop[i];
 
-                        hdr_props.max_luma = pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, dm_data->source_max_pq / 4095.0f);
-                    }
+                    autocrop->scene_valid = true;
                 }
+
+                autocrop->scene_n = src_n;
+                scene_crop = (autocrop->scene_valid) ? &autocrop->scene_crop : &crop;
             }
         }
 
-        auto& dst_pl_csp{d->dst_frame.color};
-        pl_color_space_infer_map(&src_pl_csp, &dst_pl_csp);
-
-        if (render_filter(dst_ptr.get(), src_ptr.get(), src_n, d, fi))
-            return set_err(std::format("libplacebo_Render: {}", d->vf->log_buffer.str()));
-
-        const auto& dst_repr{d->dst_frame.repr};
-        const auto& dst_sys{dst_repr.sys};
-
         AVS_Map* dst_props{g_avs_api->avs_get_frame_props_rw(env, dst_ptr.get())};
-        const auto sync{[&](const char* name, const auto val, const auto& map) {
-            if (auto res{map.find(val)})
-                g_avs_api->avs_prop_set_int(env, dst_props, name, *res, 0);
-            else
+        const auto set_int{[&](const char* name, int64_t val) {
+            if (val >= 0)
+                g_avs_api->avs_prop_set_int(env, dst_props, name, val, 0);
+            else if (val == -1)
                 g_avs_api->avs_prop_delete_key(env, dst_props, name);
         }};
+        const auto sync{[&](const char* name, const auto val, const auto& map) {
+            const auto res{map.find(val)};
+            set_int(name, (res) ? *res : -1);
+        }};
 
-        sync("_ColorRange", dst_repr.levels, map_libpl_avs_levels);
-        sync("_Matrix", dst_sys, map_libpl_avs_matrix);
+        set_int("_ColorRange", d->out_range);
+        set_int("_Matrix", d->out_matrix);
+        set_int("_ChromaLocation", d->out_cplace);
         sync("_Transfer", dst_pl_csp.transfer, map_libpl_avs_trc);
         sync("_Primaries", dst_pl_csp.primaries, map_libpl_avs_prim);
 
-        if (dst_sys != PL_COLOR_SYSTEM_RGB)
-            sync("_ChromaLocation", d->dst_cplace, map_libpl_avs_cplace);
+        if (d->scene)
+        {
+            set_int("_SceneChangePrev", diff_prev >= d->scene->threshold);
+            set_int("_SceneChangeNext", diff_next >= d->scene->threshold);
+            g_avs_api->avs_prop_set_float(env, dst_props, "FrameDiffPrev", diff_prev, 0);
+        }
+
+        if (d->autocrop)
+        {
+            static constexpr std::array crop_keys{"CropLeft", "CropTop", "CropRight", "CropBottom"};
+            static constexpr std::array scene_crop_keys{"CropSceneLeft", "CropSceneTop", "CropSceneRight", "CropSceneBottom"};
+            for (size_t i{0}; i < crop_keys.size(); ++i)
+            {
+                set_int(crop_keys[i], crop[i]);
+                if (scene_crop)
+                    set_int(scene_crop_keys[i], (*scene_crop)[i]);
+            }
+        }
 
         if (deinterlace_data)
         {
@@ -531,35 +1549,17 @@ namespace
     void AVSC_CC free_render(AVS_FilterInfo* fi) noexcept
     {
         render_context* d{reinterpret_cast<render_context*>(fi->user_data)};
-        const auto& vf{d->vf};
-        const auto& cache_path{d->cache_path};
-
-        if (!cache_path.empty() && vf && vf->cache_obj && d->cache_signature != pl_cache_signature(vf->cache_obj.get()))
-        {
-            const size_t size{pl_cache_save(vf->cache_obj.get(), nullptr, 0)};
-            std::vector<std::byte> data(size);
-            size_t written{pl_cache_save(vf->cache_obj.get(), reinterpret_cast<uint8_t*>(data.data()), size)};
-
-            if (written > 0)
-            {
-                if (const auto parent{cache_path.parent_path()}; !parent.empty())
-                {
-                    std::error_code ec;
-                    std::filesystem::create_directories(parent, ec);
-                }
-
-                std::ofstream f(cache_path, std::ios::binary | std::ios::trunc);
-                if (f.good())
-                    f.write(reinterpret_cast<const char*>(data.data()), written);
-            }
-        }
-
         delete d;
     }
 
     int AVSC_CC render_set_cache_hints(AVS_FilterInfo* fi, int cachehints, int frame_range) noexcept
     {
-        return cachehints == AVS_CACHE_GET_MTMODE ? 2 : 0;
+        if (cachehints != AVS_CACHE_GET_MTMODE)
+            return 0;
+
+        // The CropScene* aggregate needs the frames of one instance in order; MT_MULTI_INSTANCE would split them between instances.
+        const render_context* d{reinterpret_cast<render_context*>(fi->user_data)};
+        return (d->autocrop && d->scene) ? 3 : 2;
     }
 
     int AVSC_CC render_get_parity(AVS_FilterInfo* fi, int n) noexcept
@@ -583,12 +1583,6 @@ namespace
     {
         const auto open_file{[](const char* p) -> FILE* {
 #ifdef _WIN32
-            const auto to_wide{[](const char* s, UINT cp) {
-                const int size = MultiByteToWideChar(cp, 0, s, -1, nullptr, 0);
-                std::wstring w(size, 0);
-                MultiByteToWideChar(cp, 0, s, -1, w.data(), size);
-                return w;
-            }};
             FILE* f{_wfopen(to_wide(p, CP_UTF8).c_str(), L"rb")};
             if (!f)
                 f = _wfopen(to_wide(p, CP_ACP).c_str(), L"rb");
@@ -660,16 +1654,167 @@ namespace
     }
 } // namespace
 
+int source_layout(const AVS_VideoInfo* vi, pl_fmt_type type, std::array<plane_upload, 4>& layout) noexcept
+{
+    const auto packed_rgb{[&](int comp_size, int num_comp) {
+        const int bits{comp_size * 8};
+        // BGR(A)
+        layout[0] = {AVS_DEFAULT_PLANE,
+            {
+                .type = PL_FMT_UNORM,
+                .component_size = {bits, bits, bits, (num_comp > 3) ? bits : 0},
+                .component_map = {2, 1, 0, 3},
+                .pixel_stride = static_cast<size_t>(comp_size) * num_comp,
+            }};
+        return 1;
+    }};
+
+    switch (vi->pixel_type)
+    {
+        case AVS_CS_BGR24:
+            return packed_rgb(1, 3);
+        case AVS_CS_BGR32:
+            return packed_rgb(1, 4);
+        case AVS_CS_BGR48:
+            return packed_rgb(2, 3);
+        case AVS_CS_BGR64:
+            return packed_rgb(2, 4);
+        case AVS_CS_YUY2:
+            // Y0 U Y1 V: the luma texture skips the chroma bytes, the half width chroma texture skips the luma bytes.
+            layout[0] = {AVS_DEFAULT_PLANE, {.type = PL_FMT_UNORM, .component_size = {8}, .component_map = {0}, .pixel_stride = 2}};
+            layout[1] = {AVS_DEFAULT_PLANE,
+                {.type = PL_FMT_UNORM, .component_size = {8, 8}, .component_pad = {8, 8}, .component_map = {1, 2}, .pixel_stride = 4}};
+            return 2;
+        default:
+            break;
+    }
+
+    if (!avs_is_planar(vi))
+        return 0;
+
+    static constexpr std::array rgb_planes{AVS_PLANAR_R, AVS_PLANAR_G, AVS_PLANAR_B, AVS_PLANAR_A};
+    static constexpr std::array yuv_planes{AVS_PLANAR_Y, AVS_PLANAR_U, AVS_PLANAR_V, AVS_PLANAR_A};
+    const auto& planes{avs_is_rgb(vi) ? rgb_planes : yuv_planes};
+    const int num_planes{g_avs_api->avs_num_components(vi)};
+    const int comp_size{g_avs_api->avs_component_size(vi)};
+
+    for (int i{0}; i < num_planes; ++i)
+    {
+        layout[i] = {planes[i],
+            {
+                .type = type,
+                .component_size = {comp_size * 8},
+                .component_map = {i},
+                .pixel_stride = static_cast<size_t>(comp_size),
+            }};
+    }
+
+    return num_planes;
+}
+
+bool upload_planes(
+    priv& vf, AVS_VideoFrame* src, std::span<const plane_upload> layout, std::array<pl_tex, 4>& textures, pl_timer timer) noexcept
+{
+    const auto& gpu{vf.vk->gpu};
+
+    for (size_t i{0}; i < layout.size(); ++i)
+    {
+        const int plane{layout[i].plane};
+        pl_plane_data source{layout[i].data};
+        source.width = g_avs_api->avs_get_row_size_p(src, plane) / static_cast<int>(source.pixel_stride);
+        source.height = g_avs_api->avs_get_height_p(src, plane);
+        source.row_stride = static_cast<size_t>(g_avs_api->avs_get_pitch_p(src, plane));
+        source.pixels = g_avs_api->avs_get_read_ptr_p(src, plane);
+
+        if (!timer)
+        {
+            if (!pl_upload_plane(gpu, NULL, &textures[i], &source))
+                return false;
+        }
+        else
+        {
+            // pl_upload_plane() takes no timer. This is the same upload; the plane mapping it also returns isn't needed here.
+            const pl_fmt fmt{pl_plane_find_fmt(gpu, NULL, &source)};
+            if (!fmt)
+                return false;
+
+            const pl_tex_params t_params{
+                .w = source.width,
+                .h = source.height,
+                .format = fmt,
+                .sampleable = true,
+                .blit_src = static_cast<bool>(fmt->caps & PL_FMT_CAP_BLITTABLE),
+                .host_writable = true,
+            };
+
+            if (!pl_tex_recreate(gpu, &textures[i], &t_params))
+                return false;
+
+            const pl_tex_transfer_params ttr{
+                .tex = textures[i],
+                .row_pitch = source.row_stride,
+                .timer = timer,
+                .ptr = const_cast<void*>(source.pixels),
+            };
+
+            if (!pl_tex_upload(gpu, &ttr))
+                return false;
+        }
+
+        if (source.type == PL_FMT_FLOAT && (plane == AVS_PLANAR_U || plane == AVS_PLANAR_V))
+        {
+            pl_tex_params t_fix{textures[i]->params};
+            t_fix.renderable = true;
+            t_fix.host_writable = false;
+
+            auto& fix_fbo_in{vf.fix_fbo_in};
+            if (!pl_tex_recreate(gpu, &fix_fbo_in, &t_fix))
+                return false;
+            if (fix_chroma_offset(vf, textures[i], fix_fbo_in, true))
+                return false;
+
+            std::swap(textures[i], fix_fbo_in);
+        }
+    }
+
+    return true;
+}
+
 AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void* param)
 {
     AVS_FilterInfo* fi;
     const avs_helpers::avs_clip_ptr clip_ptr{g_avs_api->avs_new_c_filter(env, &fi, avs_array_elt(args, get_param_idx<"clip">()), 1)};
     AVS_Clip* clip{clip_ptr.get()};
     auto params{std::make_unique<render_context>()};
+    const filter_options opts{options_from_args(args)};
 
     auto& vi{fi->vi};
+    const AVS_VideoInfo src_vi{vi};
+    params->src_last_frame = src_vi.num_frames - 1;
     if (!avs_is_planar(&vi))
-        return avs_new_value_error("libplacebo_Render: clip must be in planar format.");
+    {
+        // Packed clips are uploaded as they are; without out_fmt the output is the planar format with the same components.
+        switch (vi.pixel_type)
+        {
+            case AVS_CS_BGR24:
+                vi.pixel_type = AVS_CS_RGBP;
+                break;
+            case AVS_CS_BGR32:
+                vi.pixel_type = AVS_CS_RGBAP;
+                break;
+            case AVS_CS_BGR48:
+                vi.pixel_type = AVS_CS_RGBP16;
+                break;
+            case AVS_CS_BGR64:
+                vi.pixel_type = AVS_CS_RGBAP16;
+                break;
+            case AVS_CS_YUY2:
+                vi.pixel_type = AVS_CS_YV16;
+                break;
+            default:
+                return avs_new_value_error("libplacebo_Render: clip must be in planar format, RGB24, RGB32, RGB48, RGB64 or YUY2.");
+        }
+    }
 
     const int src_num_comp{g_avs_api->avs_num_components(&vi)};
     const int is_src_rgb{avs_is_rgb(&vi)};
@@ -677,13 +1822,16 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     std::string msg;
 
     // --- Device Initialization ---
+    const auto ladder{opts.get<std::string>(get_param_idx<"ladder">())};
+    std::shared_ptr<ladder_group> group;
     {
-        int device{avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"device">()).value_or(-1)};
-        const int list_devices{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"list_devices">()).value_or(0)};
+        int device{opts.get<int>(get_param_idx<"device">()).value_or(-1)};
+        const int list_devices{opts.get<bool>(get_param_idx<"list_devices">()).value_or(0)};
+        const bool device_benchmark{opts.get<bool>(get_param_idx<"device_benchmark">()).value_or(false)};
 
         std::vector<VkPhysicalDevice> devices{};
         vk_inst_ptr inst;
-        const auto dev_info{devices_info(clip, fi->env, devices, inst, device, list_devices)};
+        const auto dev_info{devices_info(clip, fi->env, devices, inst, device, list_devices, device_benchmark)};
 
         if (dev_info)
         {
@@ -695,11 +1843,7 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
         if (list_devices)
         {
             for (size_t i{0}; i < devices.size(); ++i)
-            {
-                VkPhysicalDeviceProperties properties{};
-                vkGetPhysicalDeviceProperties(devices[i], &properties);
-                msg += std::to_string(i) + ": " + std::string(properties.deviceName) + "\n";
-            }
+                msg += std::format("{}: {}\n", i, device_description(inst.get(), devices[i], device_benchmark));
 
             AVS_Value cl;
             g_avs_api->avs_set_to_clip(&cl, clip);
@@ -713,38 +1857,63 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
             return inv;
         }
 
-        params->vf = avs_libplacebo_init(inst, devices[device], msg);
-        if (!msg.empty())
-            return avs_err_val(env, std::format("libplacebo_Render: {}", msg));
-    }
+        std::unique_lock registry_lock(ladder_registry_mtx, std::defer_lock);
+        if (ladder)
+        {
+            registry_lock.lock();
+            group = ladder_registry[*ladder].lock();
+        }
 
-    const auto& gpu{params->vf->vk->gpu};
+        // The clip value holds the source filter itself, which identifies the source clip across instances.
+        const void* source{avs_array_elt(args, get_param_idx<"clip">()).d.clip};
+        if (group)
+        {
+            const auto& g_vi{group->vi};
+            if (group->source != source || g_vi.width != src_vi.width || g_vi.height != src_vi.height ||
+                g_vi.pixel_type != src_vi.pixel_type || g_vi.num_frames != src_vi.num_frames ||
+                g_vi.fps_numerator != src_vi.fps_numerator || g_vi.fps_denominator != src_vi.fps_denominator)
+                return avs_err_val(
+                    env, std::format("libplacebo_Render: all instances of ladder '{}' must use the same source clip.", *ladder));
+            if (group->device != device)
+                return avs_err_val(env, std::format("libplacebo_Render: all instances of ladder '{}' must use the same device.", *ladder));
+            if (!same_ladder_options(group->options, opts))
+                return avs_err_val(env, std::format("libplacebo_Render: all instances of ladder '{}' must use the same pre-processing, "
+                                                    "source and intermediate options.",
+                                            *ladder));
+
+            params->vf = group->vf;
+        }
+        else
+        {
+            vk_queue_options queues{};
+            update_param(opts.get<bool>(get_param_idx<"async_transfer">()), queues.async_transfer);
+            update_param(opts.get<bool>(get_param_idx<"async_compute">()), queues.async_compute);
+            if (!update_param(opts.get<int>(get_param_idx<"queue_count">()), queues.queue_count, "queue_count", msg, 1, 8))
+                return avs_err_val(env, msg);
 
-    // --- Shader Cache Loading ---
-    if (const auto cache_path_arg{avs_helpers::get_opt_arg<const char*>(env, args, get_param_idx<"shader_cache">())};
-        cache_path_arg && *cache_path_arg)
-    {
-        params->cache_path = *cache_path_arg;
-        const auto& cache_path{params->cache_path};
-        std::error_code ec;
+            const auto cache_path{opts.get<const char*>(get_param_idx<"cache_path">())};
+            params->vf =
+                avs_libplacebo_init(inst, devices[device], acquire_shared_cache(device, cache_path.value_or(nullptr)), queues, msg);
+            if (!msg.empty())
+                return avs_err_val(env, std::format("libplacebo_Render: {}", msg));
 
-        if (std::filesystem::exists(cache_path) && std::filesystem::is_regular_file(cache_path))
-        {
-            const auto size{std::filesystem::file_size(cache_path, ec)};
-            if (!ec && size > 0)
+            if (ladder)
             {
-                std::vector<std::byte> data(size);
-                std::ifstream f(cache_path, std::ios::binary);
-                if (f.read(reinterpret_cast<char*>(data.data()), size))
-                    pl_cache_load(params->vf->cache_obj.get(), reinterpret_cast<const uint8_t*>(data.data()), size);
-
-                params->cache_signature = pl_cache_signature(params->vf->cache_obj.get());
+                group = std::make_shared<ladder_group>();
+                group->vf = params->vf;
+                group->source = source;
+                group->vi = src_vi;
+                group->device = device;
+                group->options = opts;
+                ladder_registry[*ladder] = group;
             }
         }
     }
 
+    const auto& gpu{params->vf->vk->gpu};
+
     // --- Preset & Render Params ---
-    const auto preset{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"preset">())};
+    const auto preset{opts.get<std::string>(get_param_idx<"preset">())};
     if (preset)
     {
         const std::optional<pl_render_params> base_params{[&]() -> std::optional<pl_render_params> {
@@ -771,75 +1940,110 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     // --- Geometry ---
     const int src_w{vi.width};
     const int src_h{vi.height};
-    if (!update_param(avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"width">()), vi.width, "width", msg, 16))
+    if (!update_param(opts.get<int>(get_param_idx<"width">()), vi.width, "width", msg, 16))
         return avs_err_val(env, msg);
-    if (!update_param(avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"height">()), vi.height, "height", msg, 16))
+    if (!update_param(opts.get<int>(get_param_idx<"height">()), vi.height, "height", msg, 16))
         return avs_err_val(env, msg);
 
-    const float crop_x{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"src_left">()).value_or(0.0f)};
-    const float crop_y{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"src_top">()).value_or(0.0f)};
-    const float crop_w{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"src_width">()).value_or(0.0f)};
-    const float crop_h{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"src_height">()).value_or(0.0f)};
+    const float crop_x{opts.get<float>(get_param_idx<"src_left">()).value_or(0.0f)};
+    const float crop_y{opts.get<float>(get_param_idx<"src_top">()).value_or(0.0f)};
+    const float crop_w{opts.get<float>(get_param_idx<"src_width">()).value_or(0.0f)};
+    const float crop_h{opts.get<float>(get_param_idx<"src_height">()).value_or(0.0f)};
+
+    if (const auto crop_props{opts.get<std::string>(get_param_idx<"crop_props">())})
+    {
+        if (crop_props->empty())
+            return avs_new_value_error("libplacebo_Render: crop_props cannot be empty.");
+
+        params->crop_keys = {*crop_props + "Left", *crop_props + "Top", *crop_props + "Right", *crop_props + "Bottom"};
+    }
 
     // --- Custom Shader ---
-    if (const auto custom_shader{avs_helpers::get_opt_arg<const char*>(env, args, get_param_idx<"custom_shader_path">())})
+    if (const auto custom_shaders{opts.get_array<std::string_view>(get_param_idx<"custom_shader_path">())};
+        !custom_shaders.empty())
     {
-        auto content{load_file_content(*custom_shader, msg)};
-        if (!content)
-            return avs_err_val(env, std::format("libplacebo_Render: {}", msg));
+        const auto shader_params{opts.get_array<std::string_view>(get_param_idx<"custom_shader_param">())};
+        if (shader_params.size() > custom_shaders.size())
+            return avs_new_value_error("libplacebo_Render: custom_shader_param cannot have more elements than custom_shader_path.");
+
+        const auto replace_define{[](std::string& source, std::string_view key, std::string_view value) {
+            std::string search_target{"#define " + std::string(key)};
+            const size_t pos{source.find(search_target)};
+            if (pos != std::string::npos)
+            {
+                const size_t val_start{source.find_first_not_of(" \t", pos + search_target.length())};
+                if (val_start == std::string::npos)
+                    return;
 
-        if (const auto shader_param{avs_helpers::get_opt_arg<std::string_view>(env, args, get_param_idx<"custom_shader_param">())})
-        {
-            std::string_view shader_p{*shader_param};
-            const auto replace_define{[](std::string& source, std::string_view key, std::string_view value) {
-                std::string search_target{"#define " + std::string(key)};
-                const size_t pos{source.find(search_target)};
-                if (pos != std::string::npos)
-                {
-                    const size_t val_start{source.find_first_not_of(" \t", pos + search_target.length())};
-                    if (val_start == std::string::npos)
-                        return;
+                size_t val_end{source.find_first_of(" \t\n\r/", val_start)};
+                if (val_end == std::string::npos)
+                    val_end = source.length();
 
-                    size_t val_end{source.find_first_of(" \t\n\r/", val_start)};
-                    if (val_end == std::string::npos)
-                        val_end = source.length();
+                source.replace(val_start, val_end - val_start, value);
+            }
+        }};
 
-                    source.replace(val_start, val_end - val_start, value);
-                }
-            }};
+        for (size_t i{0}; i < custom_shaders.size(); ++i)
+        {
+            const std::string shader_path{custom_shaders[i]};
+            auto content{load_file_content(shader_path.c_str(), msg)};
+            if (!content)
+                return avs_err_val(env, std::format("libplacebo_Render: {}", msg));
 
-            size_t start{0};
-            const std::string_view delimiters{" ,;"};
-            while (start < shader_p.size())
+            std::vector<std::pair<std::string_view, std::string_view>> prop_params;
+            if (i < shader_params.size())
             {
-                start = shader_p.find_first_not_of(delimiters, start);
-                if (start == std::string_view::npos)
-                    break;
+                const std::string_view shader_p{shader_params[i]};
+                size_t start{0};
+                const std::string_view delimiters{" ,;"};
+                while (start < shader_p.size())
+                {
+                    start = shader_p.find_first_not_of(delimiters, start);
+                    if (start == std::string_view::npos)
+                        break;
 
-                const size_t eq_pos = shader_p.find('=', start);
-                if (eq_pos == std::string_view::npos)
-                    return avs_new_value_error("libplacebo_Render: invalid format (missing '=')");
+                    const size_t eq_pos = shader_p.find('=', start);
+                    if (eq_pos == std::string_view::npos)
+                        return avs_new_value_error("libplacebo_Render: invalid format (missing '=')");
 
-                size_t next_delim{shader_p.find_first_of(delimiters, eq_pos)};
-                if (next_delim == std::string_view::npos)
-                    next_delim = shader_p.size();
+                    size_t next_delim{shader_p.find_first_of(delimiters, eq_pos)};
+                    if (next_delim == std::string_view::npos)
+                        next_delim = shader_p.size();
 
-                std::string_view key{shader_p.substr(start, eq_pos - start)};
-                std::string_view value{shader_p.substr(eq_pos + 1, next_delim - (eq_pos + 1))};
-                if (!key.empty() && !value.empty())
-                    replace_define(*content, key, value);
+                    std::string_view key{shader_p.substr(start, eq_pos - start)};
+                    std::string_view value{shader_p.substr(eq_pos + 1, next_delim - (eq_pos + 1))};
+                    if (!key.empty() && value.starts_with("prop:") && value.size() > 5)
+                        prop_params.emplace_back(key, value.substr(5));
+                    else if (!key.empty() && !value.empty())
+                        replace_define(*content, key, value);
 
-                start = next_delim;
+                    start = next_delim;
+                }
             }
-        }
 
-        params->shader.reset(pl_mpv_user_shader_parse(gpu, content->c_str(), content->size()));
-        if (!params->shader)
-            return avs_new_value_error("libplacebo_Render: failed parsing shader!");
+            const auto& shader{params->shaders.emplace_back(pl_mpv_user_shader_parse(gpu, content->c_str(), content->size()))};
+            if (!shader)
+                return avs_err_val(env, std::format("libplacebo_Render: failed parsing shader '{}'!", shader_path));
+
+            for (const auto& [key, prop] : prop_params)
+            {
+                const std::span<const pl_hook_par> pars{shader->parameters, static_cast<size_t>(shader->num_parameters)};
+                const auto par{std::ranges::find_if(pars, [&](const pl_hook_par& p) { return key == p.name; })};
+                if (par == pars.end())
+                    return avs_err_val(env, std::format("libplacebo_Render: shader '{}' has no parameter '{}'.", shader_path, key));
+                if (par->mode != PL_HOOK_PAR_VARIABLE && par->mode != PL_HOOK_PAR_DYNAMIC)
+                    return avs_err_val(env, std::format("libplacebo_Render: shader parameter '{}' must be a variable parameter to be set "
+                                                        "from a frame property.",
+                                                key));
+
+                params->shader_prop_params.emplace_back(&*par, std::string{prop});
+            }
+
+            params->shader_hooks.emplace_back(shader.get());
+        }
 
-        params->shader_hooks[0] = params->shader.get();
         render_data->hooks = params->shader_hooks.data();
-        render_data->num_hooks = 1;
+        render_data->num_hooks = static_cast<int>(params->shader_hooks.size());
     }
 
     // --- Scaler
@@ -863,23 +2067,23 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
 
         auto parse_scaler{[&](const scaler_args_ids& ids, std::unique_ptr<pl_filter_config>& storage,
                               const char* default_name) -> const pl_filter_config* {
-            const auto opt_k{avs_helpers::get_opt_arg<const char*>(env, args, ids.kernel)};
-            const auto opt_w{avs_helpers::get_opt_arg<const char*>(env, args, ids.window)};
-            const auto opt_p{avs_helpers::get_opt_arg<bool>(env, args, ids.polar)};
-            const auto opt_r{avs_helpers::get_opt_arg<float>(env, args, ids.radius)};
-            const auto opt_cl{avs_helpers::get_opt_arg<float>(env, args, ids.clamp)};
-            const auto opt_t{avs_helpers::get_opt_arg<float>(env, args, ids.taper)};
-            const auto opt_b{avs_helpers::get_opt_arg<float>(env, args, ids.blur)};
-            const auto opt_a{avs_helpers::get_opt_arg<float>(env, args, ids.antiring)};
-
-            const auto opt_p1{avs_helpers::get_opt_arg<float>(env, args, ids.param1)};
-            const auto opt_p2{avs_helpers::get_opt_arg<float>(env, args, ids.param2)};
-            const auto opt_wp1{avs_helpers::get_opt_arg<float>(env, args, ids.wparam1)};
-            const auto opt_wp2{avs_helpers::get_opt_arg<float>(env, args, ids.wparam2)};
+            const auto opt_k{opts.get<const char*>(ids.kernel)};
+            const auto opt_w{opts.get<const char*>(ids.window)};
+            const auto opt_p{opts.get<bool>(ids.polar)};
+            const auto opt_r{opts.get<float>(ids.radius)};
+            const auto opt_cl{opts.get<float>(ids.clamp)};
+            const auto opt_t{opts.get<float>(ids.taper)};
+            const auto opt_b{opts.get<float>(ids.blur)};
+            const auto opt_a{opts.get<float>(ids.antiring)};
+
+            const auto opt_p1{opts.get<float>(ids.param1)};
+            const auto opt_p2{opts.get<float>(ids.param2)};
+            const auto opt_wp1{opts.get<float>(ids.wparam1)};
+            const auto opt_wp2{opts.get<float>(ids.wparam2)};
 
             const bool is_mod_defined{
                 opt_k || opt_w || opt_p || opt_r || opt_cl || opt_t || opt_b || opt_a || opt_p1 || opt_p2 || opt_wp1 || opt_wp2};
-            auto name{avs_helpers::get_opt_arg<const char*>(env, args, ids.name)};
+            auto name{opts.get<const char*>(ids.name)};
             if (!name)
             {
                 if (!is_mod_defined && preset)
@@ -1031,21 +2235,20 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
         render_data->plane_upscaler = parsed_plane_upscaler;
         render_data->plane_downscaler = parsed_plane_downscaler;
 
-        if (!update_param(avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"antiringing_strength">()),
+        if (!update_param(opts.get<float>(get_param_idx<"antiringing_strength">()),
                 render_data->antiringing_strength, "antiringing_strength", msg, 0.0f, 1.0f))
             return avs_err_val(env, msg);
     }
 
     // --- Linear Scaling & Sigmoid ---
     {
-        update_param(avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"linear_scaling">()), render_data->disable_linear_scaling,
-            [](bool val) { return !val; });
+        update_param(opts.get<bool>(get_param_idx<"linear_scaling">()), render_data->disable_linear_scaling, [](bool val) { return !val; });
 
         if (!render_data->disable_linear_scaling)
         {
-            const auto sigmoid{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"sigmoid">())};
-            const auto sigmoid_center{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"sigmoid_center">())};
-            const auto sigmoid_slope{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"sigmoid_slope">())};
+            const auto sigmoid{opts.get<bool>(get_param_idx<"sigmoid">())};
+            const auto sigmoid_center{opts.get<float>(get_param_idx<"sigmoid_center">())};
+            const auto sigmoid_slope{opts.get<float>(get_param_idx<"sigmoid_slope">())};
 
             if (sigmoid && !*sigmoid)
             {
@@ -1068,12 +2271,12 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
 
     // --- Deband ---
     {
-        const auto deband{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"deband">())};
-        const auto deband_it{avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"deband_iterations">())};
-        const auto deband_thr{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"deband_threshold">())};
-        const auto deband_rad{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"deband_radius">())};
-        const auto deband_gr{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"deband_grain">())};
-        // const auto deband_gr_neutral{avs_helpers::get_opt_array_as_vector<float>(env, args, get_param_idx<"deband_grain_neutral">())};
+        const auto deband{opts.get<bool>(get_param_idx<"deband">())};
+        const auto deband_it{opts.get<int>(get_param_idx<"deband_iterations">())};
+        const auto deband_thr{opts.get<float>(get_param_idx<"deband_threshold">())};
+        const auto deband_rad{opts.get<float>(get_param_idx<"deband_radius">())};
+        const auto deband_gr{opts.get<float>(get_param_idx<"deband_grain">())};
+        // const auto deband_gr_neutral{opts.get_array<float>(get_param_idx<"deband_grain_neutral">())};
 
         if (deband && !*deband)
         {
@@ -1115,7 +2318,6 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     }
 
     // --- Source Color Space ---
-    params->src_num_planes = src_num_comp;
     params->src_comp_size = g_avs_api->avs_component_size(&vi);
 
     auto& src_frame{params->src_frame};
@@ -1127,7 +2329,12 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
             .y1 = (crop_h > 0.0f) ? crop_y + crop_h : src_h + crop_h},
     };
 
-    const auto opt_src_csp{avs_helpers::get_opt_arg<std::string_view>(env, args, get_param_idx<"src_csp">())};
+    params->static_crop = src_frame.crop;
+    params->src_flipped = is_src_rgb && !avs_is_planar(&src_vi);
+    if (params->src_flipped)
+        flip_crop(src_frame.crop, static_cast<float>(src_w), static_cast<float>(src_h));
+
+    const auto opt_src_csp{opts.get<std::string_view>(get_param_idx<"src_csp">())};
     std::string src_csp{!opt_src_csp ? is_src_rgb ? "srgb" : "sdr" : *opt_src_csp};
     if (!apply_csp_preset(src_csp, src_frame.color, src_frame.repr))
         return avs_err_val(env, std::format("libplacebo_Render: Unknown src_csp preset '{}'.", src_csp));
@@ -1150,34 +2357,34 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     };
 
     {
-        if (process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"src_matrix">()), parse_matrix, src_sys,
+        if (process_param(opts.get<std::string>(get_param_idx<"src_matrix">()), parse_matrix, src_sys,
                 "src_matrix", &params->is_matrix_def);
             !msg.empty())
             return avs_err_val(env, msg);
-        if (process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"src_trc">()), parse_trc, src_frame.color.transfer,
+        if (process_param(opts.get<std::string>(get_param_idx<"src_trc">()), parse_trc, src_frame.color.transfer,
                 "src_trc", &params->is_trc_def);
             !msg.empty())
             return avs_err_val(env, msg);
-        if (process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"src_prim">()), parse_prim,
+        if (process_param(opts.get<std::string>(get_param_idx<"src_prim">()), parse_prim,
                 src_frame.color.primaries, "src_prim", &params->is_prim_def);
             !msg.empty())
             return avs_err_val(env, msg);
 
-        if (const auto specified{process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"src_levels">()),
+        if (const auto specified{process_param(opts.get<std::string>(get_param_idx<"src_levels">()),
                 parse_levels, src_frame.repr.levels, "src_levels", &params->is_levels_def)};
             !msg.empty())
             return avs_err_val(env, msg);
         else if (!specified)
             src_frame.repr.levels = (is_src_rgb || src_bit_depth == 32) ? PL_COLOR_LEVELS_FULL : PL_COLOR_LEVELS_LIMITED;
 
-        if (const auto specified{process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"src_alpha">()), parse_alpha,
+        if (const auto specified{process_param(opts.get<std::string>(get_param_idx<"src_alpha">()), parse_alpha,
                 src_frame.repr.alpha, "src_alpha")};
             !msg.empty())
             return avs_err_val(env, msg);
         else if (!specified)
             src_frame.repr.alpha = (src_num_comp > 3) ? PL_ALPHA_INDEPENDENT : PL_ALPHA_NONE;
 
-        if (const auto specified{process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"src_cplace">()),
+        if (const auto specified{process_param(opts.get<std::string>(get_param_idx<"src_cplace">()),
                 parse_cplace, params->src_cplace, "src_cplace")};
             !msg.empty())
             return avs_err_val(env, msg);
@@ -1213,42 +2420,22 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
         // Aspect Mode
         int aspect_mode{0};
 
-        if (process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"aspect_mode">()), parse_aspect_mode, aspect_mode,
-                "aspect_mode");
+        if (process_param(opts.get<std::string>(get_param_idx<"aspect_mode">()), parse_aspect_mode, aspect_mode, "aspect_mode");
             !msg.empty())
             return avs_err_val(env, msg);
 
-        const auto border{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"border">())};
-        const auto border_color{avs_helpers::get_opt_array_as_vector<float>(env, args, get_param_idx<"border_color">())};
-        const auto background_transparency{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"background_transparency">())};
-        const auto blur_radius{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"blur_radius">())};
+        const auto border{opts.get<std::string>(get_param_idx<"border">())};
+        const auto border_color{opts.get_array<float>(get_param_idx<"border_color">())};
+        const auto background_transparency{opts.get<float>(get_param_idx<"background_transparency">())};
+        const auto blur_radius{opts.get<float>(get_param_idx<"blur_radius">())};
 
         if (aspect_mode || border || !border_color.empty() || background_transparency || blur_radius)
         {
             if (!aspect_mode)
                 aspect_mode = 1;
 
-            const float src_w_eff{std::abs(src_frame.crop.x1 - src_frame.crop.x0)};
-            const float src_h_eff{std::abs(src_frame.crop.y1 - src_frame.crop.y0)};
-
-            if (src_w_eff > 0.0f && src_h_eff > 0.0f)
-            {
-                const float dst_w{static_cast<float>(vi.width)};
-                const float dst_h{static_cast<float>(vi.height)};
-
-                const float scale_x{dst_w / src_w_eff};
-                const float scale_y{dst_h / src_h_eff};
-
-                const float scale{(aspect_mode == 1) ? (std::min)(scale_x, scale_y) : (std::max)(scale_x, scale_y)};
-
-                const float draw_w{src_w_eff * scale};
-                const float draw_h{src_h_eff * scale};
-
-                dst_frame.crop = {.x0 = (dst_w - draw_w) / 2.0f,
-                    .y0 = (dst_h - draw_h) / 2.0f,
-                    .x1 = (dst_w + draw_w) / 2.0f,
-                    .y1 = (dst_h + draw_h) / 2.0f};
-            }
+            params->aspect_mode = aspect_mode;
+            dst_frame.crop = aspect_rect(src_frame.crop, aspect_mode, static_cast<float>(vi.width), static_cast<float>(vi.height));
 
             if (process_param(border, parse_clear_mode, render_data->border, "border"); !msg.empty())
                 return avs_err_val(env, msg);
@@ -1278,7 +2465,7 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
         }
     }
 
-    const auto dst_csp{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"dst_csp">())};
+    const auto dst_csp{opts.get<std::string>(get_param_idx<"dst_csp">())};
     std::string_view dst_csp_fmt;
     if (dst_csp)
     {
@@ -1294,40 +2481,37 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     }
 
     const auto dst_matrix{process_param(
-        avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"dst_matrix">()), parse_matrix, dst_frame.repr.sys, "dst_matrix")};
+        opts.get<std::string>(get_param_idx<"dst_matrix">()), parse_matrix, dst_frame.repr.sys, "dst_matrix")};
     if (!msg.empty())
         return avs_err_val(env, msg);
     if (dst_frame.repr.sys == PL_COLOR_SYSTEM_DOLBYVISION)
         return avs_new_value_error("libplacebo_Render: Dolby Vision dst_matrix is not supported.");
 
-    if (process_param(
-            avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"dst_trc">()), parse_trc, dst_frame.color.transfer, "dst_trc");
+    if (process_param(opts.get<std::string>(get_param_idx<"dst_trc">()), parse_trc, dst_frame.color.transfer, "dst_trc");
         !msg.empty())
         return avs_err_val(env, msg);
-    if (process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"dst_prim">()), parse_prim, dst_frame.color.primaries,
-            "dst_prim");
+    if (process_param(opts.get<std::string>(get_param_idx<"dst_prim">()), parse_prim, dst_frame.color.primaries, "dst_prim");
         !msg.empty())
         return avs_err_val(env, msg);
 
-    const auto dst_levels{process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"dst_levels">()), parse_levels,
+    const auto dst_levels{process_param(opts.get<std::string>(get_param_idx<"dst_levels">()), parse_levels,
         dst_frame.repr.levels, "dst_levels")};
     if (!msg.empty())
         return avs_err_val(env, msg);
     const auto dst_alpha{process_param(
-        avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"dst_alpha">()), parse_alpha, dst_frame.repr.alpha, "dst_alpha")};
+        opts.get<std::string>(get_param_idx<"dst_alpha">()), parse_alpha, dst_frame.repr.alpha, "dst_alpha")};
     if (!msg.empty())
         return avs_err_val(env, msg);
     // Handle default dst_alpha later with out_fmt.
 
-    if (const auto s{process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"dst_cplace">()), parse_cplace,
-            params->dst_cplace, "dst_cplace")};
+    if (const auto s{process_param(opts.get<std::string>(get_param_idx<"dst_cplace">()), parse_cplace, params->dst_cplace, "dst_cplace")};
         !msg.empty())
         return avs_err_val(env, msg);
     else if (!s)
         params->dst_cplace = PL_CHROMA_LEFT;
 
     const pl_color_map_params* color_map_base{[&]() -> const pl_color_map_params* {
-        if (const auto s{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"color_map_preset">())})
+        if (const auto s{opts.get<std::string>(get_param_idx<"color_map_preset">())})
         {
             if (iequals(*s, "default"))
                 return &pl_color_map_default_params;
@@ -1350,17 +2534,17 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     {
         color_map_params = std::make_unique<pl_color_map_params>(*color_map_base);
 
-        const auto g_mapping{avs_helpers::get_opt_arg<const char*>(env, args, get_param_idx<"gamut_mapping">())};
-        const auto p_deadzone{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"perceptual_deadzone">())};
-        const auto p_strength{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"perceptual_strength">())};
-        const auto c_gamma{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"colorimetric_gamma">())};
-        const auto s_knee{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"softclip_knee">())};
-        const auto s_desat{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"softclip_desat">())};
-        const auto lut3d_size_i{avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"lut3d_size_i">())};
-        const auto lut3d_size_c{avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"lut3d_size_c">())};
-        const auto lut3d_size_h{avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"lut3d_size_h">())};
-        const auto lut3d_tricubic{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"lut3d_tricubic">())};
-        const auto g_expansion{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"gamut_expansion">())};
+        const auto g_mapping{opts.get<const char*>(get_param_idx<"gamut_mapping">())};
+        const auto p_deadzone{opts.get<float>(get_param_idx<"perceptual_deadzone">())};
+        const auto p_strength{opts.get<float>(get_param_idx<"perceptual_strength">())};
+        const auto c_gamma{opts.get<float>(get_param_idx<"colorimetric_gamma">())};
+        const auto s_knee{opts.get<float>(get_param_idx<"softclip_knee">())};
+        const auto s_desat{opts.get<float>(get_param_idx<"softclip_desat">())};
+        const auto lut3d_size_i{opts.get<int>(get_param_idx<"lut3d_size_i">())};
+        const auto lut3d_size_c{opts.get<int>(get_param_idx<"lut3d_size_c">())};
+        const auto lut3d_size_h{opts.get<int>(get_param_idx<"lut3d_size_h">())};
+        const auto lut3d_tricubic{opts.get<bool>(get_param_idx<"lut3d_tricubic">())};
+        const auto g_expansion{opts.get<bool>(get_param_idx<"gamut_expansion">())};
 
         if (g_mapping || p_deadzone || p_strength || c_gamma || s_knee || s_desat || lut3d_size_i || lut3d_size_c || lut3d_size_h ||
             lut3d_tricubic || g_expansion)
@@ -1396,10 +2580,10 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
 
     // --- Dither ---
     {
-        const auto dither{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"dither">())};
-        const auto dither_m{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"dither_method">())};
-        const auto dither_lut_s{avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"dither_lut_size">())};
-        const auto dither_temp{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"dither_temporal">())};
+        const auto dither{opts.get<bool>(get_param_idx<"dither">())};
+        const auto dither_m{opts.get<std::string>(get_param_idx<"dither_method">())};
+        const auto dither_lut_s{opts.get<int>(get_param_idx<"dither_lut_size">())};
+        const auto dither_temp{opts.get<bool>(get_param_idx<"dither_temporal">())};
 
         if (dither && !*dither)
         {
@@ -1423,7 +2607,7 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
                 }
                 else
                 {
-                    if (const auto s{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"error_diffusion_k">())})
+                    if (const auto s{opts.get<std::string>(get_param_idx<"error_diffusion_k">())})
                     {
                         const auto parsed{parse_error_diffusion_k.find(*s)};
                         if (parsed)
@@ -1456,49 +2640,64 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     }
 
     // --- Custom Lut File ---
-    const auto opt_lut{avs_helpers::get_opt_arg<const char*>(env, args, get_param_idx<"lut">())};
+    const auto opt_lut{opts.get<const char*>(get_param_idx<"lut">())};
+    const auto opt_lut_export{opts.get<const char*>(get_param_idx<"lut_export">())};
+    if (opt_lut_export && !opt_lut)
+        return avs_new_value_error("libplacebo_Render: lut_export requires lut.");
     if (opt_lut)
     {
-        auto content{load_file_content(*opt_lut, msg)};
-        if (!content)
+        params->lut_ptr = load_lut(*opt_lut, msg);
+        if (!params->lut_ptr)
             return avs_err_val(env, std::format("libplacebo_Render: {}", msg));
 
-        params->lut_ptr.reset(pl_lut_parse_cube(nullptr, content->c_str(), content->size()));
-        if (!params->lut_ptr)
-            return avs_new_value_error("libplacebo_Render: failed lut parsing.");
+        if (opt_lut_export && !save_lut(*params->lut_ptr, *opt_lut_export, msg))
+            return avs_err_val(env, std::format("libplacebo_Render: {}", msg));
 
         render_data->lut = params->lut_ptr.get();
 
-        if (process_param(avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"lut_type">()), parse_lut_type,
-                render_data->lut_type, "lut_type");
+        if (process_param(opts.get<std::string>(get_param_idx<"lut_type">()), parse_lut_type, render_data->lut_type, "lut_type");
             !msg.empty())
             return avs_err_val(env, msg);
     }
 
+    // --- Film Grain ---
+    if (const auto opt_grain{opts.get<const char*>(get_param_idx<"film_grain_table">())})
+    {
+        if (!src_vi.fps_numerator || !src_vi.fps_denominator)
+            return avs_new_value_error("libplacebo_Render: film_grain_table requires a clip with a frame rate.");
+
+        params->grain = load_grain_table(*opt_grain, msg);
+        if (!params->grain)
+            return avs_err_val(env, std::format("libplacebo_Render: {}", msg));
+
+        params->grain_fps_num = src_vi.fps_numerator;
+        params->grain_fps_den = src_vi.fps_denominator;
+    }
+
     // --- Tone Mapping Function ---
     {
-        const auto tone_mapping_f{avs_helpers::get_opt_arg<const char*>(env, args, get_param_idx<"tone_mapping_function">())};
-        const auto tone_constants{avs_helpers::get_opt_array_as_vector<std::string_view>(env, args, get_param_idx<"tone_constants">())};
-        const auto inverse_tone_mapping{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"inverse_tone_mapping">())};
-        const auto tone_lut_size{avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"tone_lut_size">())};
-        const auto contrast_recovery{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"contrast_recovery">())};
-        const auto contrast_smoothness{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"contrast_smoothness">())};
-
-        const auto peak_detect{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"peak_detect">())};
-        const auto peak_detection_preset{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"peak_detection_preset">())};
-        const auto peak_smoothing_period{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"peak_smoothing_period">())};
-        const auto scene_threshold_low{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"scene_threshold_low">())};
-        const auto scene_threshold_high{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"scene_threshold_high">())};
-        const auto peak_percentile{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"peak_percentile">())};
-        const auto black_cutoff{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"black_cutoff">())};
-
-        const auto src_max{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"src_max">())};
-        const auto src_min{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"src_min">())};
-        const auto dst_max{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"dst_max">())};
-        const auto dst_min{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"dst_min">())};
-
-        const auto tone_map_metadata{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"tone_map_metadata">())};
-        const auto dovi_metadata{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"dovi_metadata">())};
+        const auto tone_mapping_f{opts.get<const char*>(get_param_idx<"tone_mapping_function">())};
+        const auto tone_constants{opts.get_array<std::string_view>(get_param_idx<"tone_constants">())};
+        const auto inverse_tone_mapping{opts.get<bool>(get_param_idx<"inverse_tone_mapping">())};
+        const auto tone_lut_size{opts.get<int>(get_param_idx<"tone_lut_size">())};
+        const auto contrast_recovery{opts.get<float>(get_param_idx<"contrast_recovery">())};
+        const auto contrast_smoothness{opts.get<float>(get_param_idx<"contrast_smoothness">())};
+
+        const auto peak_detect{opts.get<bool>(get_param_idx<"peak_detect">())};
+        const auto peak_detection_preset{opts.get<std::string>(get_param_idx<"peak_detection_preset">())};
+        const auto peak_smoothing_period{opts.get<float>(get_param_idx<"peak_smoothing_period">())};
+        const auto scene_threshold_low{opts.get<float>(get_param_idx<"scene_threshold_low">())};
+        const auto scene_threshold_high{opts.get<float>(get_param_idx<"scene_threshold_high">())};
+        const auto peak_percentile{opts.get<float>(get_param_idx<"peak_percentile">())};
+        const auto black_cutoff{opts.get<float>(get_param_idx<"black_cutoff">())};
+
+        const auto src_max{opts.get<float>(get_param_idx<"src_max">())};
+        const auto src_min{opts.get<float>(get_param_idx<"src_min">())};
+        const auto dst_max{opts.get<float>(get_param_idx<"dst_max">())};
+        const auto dst_min{opts.get<float>(get_param_idx<"dst_min">())};
+
+        const auto tone_map_metadata{opts.get<std::string>(get_param_idx<"tone_map_metadata">())};
+        const auto dovi_metadata{opts.get<bool>(get_param_idx<"dovi_metadata">())};
 
         if (tone_mapping_f || !tone_constants.empty() || inverse_tone_mapping || tone_lut_size || contrast_recovery ||
             contrast_smoothness || peak_detect || peak_detection_preset || peak_smoothing_period || scene_threshold_low ||
@@ -1651,12 +2850,12 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
 
     // --- Color Adjustment ---
     {
-        const auto opt_bright{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"brightness">())};
-        const auto opt_cont{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"contrast">())};
-        const auto opt_sat{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"saturation">())};
-        const auto opt_hue{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"hue">())};
-        const auto opt_gamma{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"gamma">())};
-        const auto opt_temp{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"temperature">())};
+        const auto opt_bright{opts.get<float>(get_param_idx<"brightness">())};
+        const auto opt_cont{opts.get<float>(get_param_idx<"contrast">())};
+        const auto opt_sat{opts.get<float>(get_param_idx<"saturation">())};
+        const auto opt_hue{opts.get<float>(get_param_idx<"hue">())};
+        const auto opt_gamma{opts.get<float>(get_param_idx<"gamma">())};
+        const auto opt_temp{opts.get<float>(get_param_idx<"temperature">())};
 
         if (opt_bright || opt_cont || opt_sat || opt_hue || opt_gamma || opt_temp)
         {
@@ -1681,9 +2880,9 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
 
     // --- Deinterlace ---
     {
-        const auto field{avs_helpers::get_opt_arg<int>(env, args, get_param_idx<"field">())};
-        const auto deint_algo{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"deinterlace_algo">())};
-        const auto spatial_check{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"spatial_check">())};
+        const auto field{opts.get<int>(get_param_idx<"field">())};
+        const auto deint_algo{opts.get<std::string>(get_param_idx<"deinterlace_algo">())};
+        const auto spatial_check{opts.get<bool>(get_param_idx<"spatial_check">())};
 
         if (field || deint_algo || spatial_check)
         {
@@ -1719,14 +2918,14 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
 
     // --- Debug ---
     {
-        const auto vis_lut{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"visualize_lut">())};
-        const auto vis_x0{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"visualize_lut_x0">())};
-        const auto vis_y0{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"visualize_lut_y0">())};
-        const auto vis_x1{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"visualize_lut_x1">())};
-        const auto vis_y1{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"visualize_lut_y1">())};
-        const auto vis_hue{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"visualize_hue">())};
-        const auto vis_theta{avs_helpers::get_opt_arg<float>(env, args, get_param_idx<"visualize_theta">())};
-        const auto show_clipping{avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"show_clipping">())};
+        const auto vis_lut{opts.get<bool>(get_param_idx<"visualize_lut">())};
+        const auto vis_x0{opts.get<float>(get_param_idx<"visualize_lut_x0">())};
+        const auto vis_y0{opts.get<float>(get_param_idx<"visualize_lut_y0">())};
+        const auto vis_x1{opts.get<float>(get_param_idx<"visualize_lut_x1">())};
+        const auto vis_y1{opts.get<float>(get_param_idx<"visualize_lut_y1">())};
+        const auto vis_hue{opts.get<float>(get_param_idx<"visualize_hue">())};
+        const auto vis_theta{opts.get<float>(get_param_idx<"visualize_theta">())};
+        const auto show_clipping{opts.get<bool>(get_param_idx<"show_clipping">())};
 
         if (vis_lut || vis_x0 || vis_y0 || vis_x1 || vis_y1 || vis_hue || vis_theta || show_clipping)
         {
@@ -1757,15 +2956,105 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     }
 
     // --- Global Render Params ---
-    if (!update_param(avs_helpers::get_opt_arg<bool>(env, args, get_param_idx<"corner_rounding">()), render_data->corner_rounding,
+    if (!update_param(opts.get<float>(get_param_idx<"corner_rounding">()), render_data->corner_rounding,
             "corner_rounding", msg, 0.0f, 1.0f))
         return avs_err_val(env, msg);
 
+    {
+        int intermediate_precision{0};
+        if (const auto specified{process_param(opts.get<std::string>(get_param_idx<"intermediate_precision">()),
+                parse_intermediate_precision, intermediate_precision, "intermediate_precision")};
+            !msg.empty())
+            return avs_err_val(env, msg);
+        else if (specified)
+        {
+            render_data->force_low_bit_depth_fbos = (intermediate_precision == 1);
+            render_data->disable_fbos = (intermediate_precision == 2);
+        }
+    }
+
+    {
+        pl_log_level log_level{PL_LOG_ERR};
+        if (const auto specified{process_param(
+                opts.get<std::string>(get_param_idx<"log_level">()), parse_log_level, log_level, "log_level")};
+            !msg.empty())
+            return avs_err_val(env, msg);
+        else if (specified)
+            pl_log_level_update(params->vf->log.get(), log_level);
+    }
+
+    if (const auto trace_path{opts.get<const char*>(get_param_idx<"trace_path">())}; trace_path && **trace_path)
+    {
+        params->trace = tracer::acquire(*trace_path);
+        render_data->info_callback = trace_info_cb;
+        render_data->info_priv = params->trace.get();
+
+        // Without pl_timer support the transfers only have their CPU spans.
+        const auto create_timer{[&](const char* name) {
+            auto t{std::make_unique<transfer_timer>(gpu)};
+            t->timer = pl_timer_create(gpu);
+            t->name = name;
+            if (!t->timer)
+                t.reset();
+            return t;
+        }};
+        params->upload_timer = create_timer("upload");
+        params->download_timer = create_timer("download");
+    }
+
+    // --- Overlays ---
+    if (const AVS_Value ov_arg{avs_array_elt(args, get_param_idx<"overlay_clips">())}; avs_defined(ov_arg))
+    {
+        const int num_overlays{avs_is_array(ov_arg) ? avs_array_size(ov_arg) : 1};
+        const auto ov_x{opts.get_array<int>(get_param_idx<"overlay_x">())};
+        const auto ov_y{opts.get_array<int>(get_param_idx<"overlay_y">())};
+        if (ov_x.size() > static_cast<size_t>(num_overlays) || ov_y.size() > static_cast<size_t>(num_overlays))
+            return avs_new_value_error("libplacebo_Render: overlay_x/overlay_y cannot have more elements than overlay_clips.");
+
+        for (int i{0}; i < num_overlays; ++i)
+        {
+            const AVS_Value v{avs_is_array(ov_arg) ? avs_array_elt(ov_arg, i) : ov_arg};
+            if (!avs_is_clip(v))
+                return avs_new_value_error("libplacebo_Render: overlay_clips must contain clips.");
+
+            auto ov{std::make_unique<overlay_source>(gpu, avs_helpers::avs_clip_ptr{g_avs_api->avs_take_clip(v, env)})};
+            const AVS_VideoInfo* ov_vi{g_avs_api->avs_get_video_info(ov->clip.get())};
+            if (ov_vi->pixel_type != AVS_CS_BGR32 && ov_vi->pixel_type != AVS_CS_BGR64)
+                return avs_new_value_error("libplacebo_Render: overlay_clips must be RGB32 or RGB64.");
+
+            ov->num_frames = ov_vi->num_frames;
+            ov->comp_size = (ov_vi->pixel_type == AVS_CS_BGR64) ? 2 : 1;
+            const float x{static_cast<float>((i < static_cast<int>(ov_x.size())) ? ov_x[i] : 0)};
+            const float y{static_cast<float>((i < static_cast<int>(ov_y.size())) ? ov_y[i] : 0)};
+            ov->dst = {x, y, x + ov_vi->width, y + ov_vi->height};
+
+            pl_color_repr repr{pl_color_repr_rgb};
+            repr.alpha = PL_ALPHA_INDEPENDENT;
+            repr.bits.sample_depth = repr.bits.color_depth = ov->comp_size * 8;
+
+            params->overlay_parts.push_back({.dst = ov->dst});
+            params->overlays.push_back({
+                .mode = PL_OVERLAY_NORMAL,
+                .coords = PL_OVERLAY_COORDS_DST_FRAME,
+                .repr = repr,
+                .color = pl_color_space_srgb,
+                .num_parts = 1,
+            });
+            params->overlay_sources.emplace_back(std::move(ov));
+        }
+
+        for (size_t i{0}; i < params->overlays.size(); ++i)
+            params->overlays[i].parts = &params->overlay_parts[i];
+
+        dst_frame.overlays = params->overlays.data();
+        dst_frame.num_overlays = static_cast<int>(params->overlays.size());
+    }
+
     if (color_map_params)
         render_data->color_map_params = color_map_params.get();
 
     // --- Output format ---
-    if (const auto out_fmt{avs_helpers::get_opt_arg<std::string>(env, args, get_param_idx<"out_fmt">())}; out_fmt || dst_csp)
+    if (const auto out_fmt{opts.get<std::string>(get_param_idx<"out_fmt">())}; out_fmt || dst_csp)
     {
         if (out_fmt && dst_csp)
             return avs_new_value_error("libplacebo_Render: out_fmt and dst_csp cannot be specified at the same time.");
@@ -1787,8 +3076,6 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
         }
 
         params->dst_num_planes = g_avs_api->avs_num_components(&vi);
-        if (render_data->error_diffusion && params->dst_num_planes > 1)
-            return avs_new_value_error("libplacebo_Render: error_diffusion support only one plane formats.");
 
         if (dst_alpha)
         {
@@ -1810,8 +3097,10 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     }
 
     // --- Libplacebo ---
-    params->src_planes = is_src_rgb ? decltype(params->src_planes){AVS_PLANAR_R, AVS_PLANAR_G, AVS_PLANAR_B, AVS_PLANAR_A}
-                                    : decltype(params->src_planes){AVS_PLANAR_Y, AVS_PLANAR_U, AVS_PLANAR_V, AVS_PLANAR_A};
+    const bool dst_packed_rgb{avs_is_rgb32(&vi) || avs_is_rgb64(&vi)};
+    const bool dst_yuy2{avs_is_yuy2(&vi)};
+    if (dst_yuy2 && (vi.width & 1))
+        return avs_new_value_error("libplacebo_Render: YUY2 output requires an even width.");
 
     params->dst_planes = avs_is_rgb(&vi) ? decltype(params->dst_planes){AVS_PLANAR_R, AVS_PLANAR_G, AVS_PLANAR_B, AVS_PLANAR_A}
                                          : decltype(params->dst_planes){AVS_PLANAR_Y, AVS_PLANAR_U, AVS_PLANAR_V, AVS_PLANAR_A};
@@ -1830,13 +3119,31 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
         return avs_new_value_error("libplacebo_Render: couldn't find src_fmt.");
 
     params->src_fmt_type = src_fmt->type;
-    src_frame.repr.bits.sample_depth = src_fmt->component_depth[0];
+    src_frame.repr.bits.sample_depth = (avs_is_planar(&src_vi)) ? src_fmt->component_depth[0] : src_sample_depth;
+
+    params->src_num_planes = source_layout(&src_vi, params->src_fmt_type, params->src_layout);
+    src_frame.num_planes = params->src_num_planes;
+    for (int i{0}; i < params->src_num_planes; ++i)
+    {
+        // Packed data is uploaded to a texture with its own channel order (and padding channels); map it back to RGB/YUV.
+        int map[4];
+        const pl_fmt fmt{pl_plane_find_fmt(gpu, map, &params->src_layout[i].data)};
+        if (!fmt)
+            return avs_new_value_error("libplacebo_Render: the device cannot upload this clip format.");
+
+        auto& plane{src_frame.planes[i]};
+        plane.components = fmt->num_components;
+        for (int c{0}; c < fmt->num_components; ++c)
+            plane.component_mapping[c] = map[c];
+    }
 
-    for (int i{0}; i < src_num_comp; ++i)
+    // An alpha plane the renderer ignores isn't uploaded.
+    if (src_frame.repr.alpha == PL_ALPHA_NONE && avs_is_planar(&src_vi) && params->src_num_planes > 3)
     {
-        src_frame.planes[i].components = 1;
-        src_frame.planes[i].component_mapping[0] = i;
+        params->src_num_planes = 3;
+        src_frame.num_planes = 3;
     }
+    params->src_upload_planes = params->src_num_planes;
 
     if (params->deinterlace_data && (params->field > -1))
         src_frame.first_field = (params->field == 1 || params->field == 3) ? PL_FIELD_TOP : PL_FIELD_BOTTOM;
@@ -1846,16 +3153,43 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
                              ? static_cast<pl_fmt_caps>(PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_HOST_READABLE | PL_FMT_CAP_SAMPLEABLE)
                              : static_cast<pl_fmt_caps>(PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_HOST_READABLE)};
     if (render_data->error_diffusion)
+    {
+        if (!gpu->glsl.compute)
+            return avs_new_value_error("libplacebo_Render: error_diffusion requires compute shader support.");
+
         dst_caps = static_cast<pl_fmt_caps>(dst_caps | PL_FMT_CAP_STORABLE);
+    }
 
     const bool is_border_color{render_data->border == PL_CLEAR_COLOR};
     if (is_border_color)
         dst_caps = static_cast<pl_fmt_caps>(dst_caps | PL_FMT_CAP_BLITTABLE);
 
-    const pl_fmt dst_fmt{
-        pl_find_fmt(gpu, (dst_sample_depth < 32) ? PL_FMT_UNORM : PL_FMT_FLOAT, 1, dst_sample_depth, dst_sample_depth, dst_caps)};
-    if (!dst_fmt)
-        return avs_new_value_error("libplacebo_Render: couldn't find dst_fmt.");
+    pl_fmt dst_fmt;
+    std::array<int, 4> dst_map{0, 1, 2, 3};
+    if (dst_packed_rgb)
+    {
+        // One BGRA texture; a device without a BGRA format renders through a swizzled RGBA one.
+        const pl_plane_data data{
+            .type = PL_FMT_UNORM,
+            .component_size = {dst_sample_depth, dst_sample_depth, dst_sample_depth, dst_sample_depth},
+            .component_map = {2, 1, 0, 3},
+            .pixel_stride = static_cast<size_t>(dst_sample_depth / 8) * 4,
+        };
+
+        dst_fmt = pl_plane_find_fmt(gpu, dst_map.data(), &data);
+        if (!dst_fmt || (dst_fmt->caps & dst_caps) != dst_caps)
+            return avs_new_value_error("libplacebo_Render: the device cannot render to packed RGB.");
+
+        params->dst_num_planes = 1;
+        params->dst_planes[0] = AVS_DEFAULT_PLANE;
+    }
+    else
+    {
+        dst_fmt =
+            pl_find_fmt(gpu, (dst_sample_depth < 32) ? PL_FMT_UNORM : PL_FMT_FLOAT, 1, dst_sample_depth, dst_sample_depth, dst_caps);
+        if (!dst_fmt)
+            return avs_new_value_error("libplacebo_Render: couldn't find dst_fmt.");
+    }
 
     dst_frame.repr.bits.color_depth = g_avs_api->avs_bits_per_component(&vi);
     dst_frame.repr.bits.sample_depth = dst_fmt->component_depth[0];
@@ -1863,29 +3197,338 @@ AVS_Value AVSC_CC create_render(AVS_ScriptEnvironment* env, AVS_Value args, void
     dst_frame.num_planes = params->dst_num_planes;
 
     const bool dst_props{(dst_frame.repr.sys == PL_COLOR_SYSTEM_RGB) || (g_avs_api->avs_num_components(&vi) == 1)};
-    const int dst_sub_w{(dst_props) ? 0 : g_avs_api->avs_get_plane_width_subsampling(&vi, AVS_PLANAR_U)};
-    const int dst_sub_h{(dst_props) ? 0 : g_avs_api->avs_get_plane_height_subsampling(&vi, AVS_PLANAR_U)};
+    const int dst_sub_w{(dst_props) ? 0 : (dst_yuy2) ? 1 : g_avs_api->avs_get_plane_width_subsampling(&vi, AVS_PLANAR_U)};
+    const int dst_sub_h{(dst_props || dst_yuy2) ? 0 : g_avs_api->avs_get_plane_height_subsampling(&vi, AVS_PLANAR_U)};
     auto& dst_planes{dst_frame.planes};
 
+    // Packed RGB is stored bottom-up; the flipped target crop renders the frame upside down.
+    params->dst_flipped = dst_packed_rgb;
+    if (params->dst_flipped)
+        flip_crop(dst_frame.crop, static_cast<float>(vi.width), static_cast<float>(vi.height));
+
+    // --- Ladder ---
+    if (group)
+    {
+        {
+            std::scoped_lock lock(group->mtx);
+            if (!group->configured)
+            {
+                static constexpr pl_fmt_caps base_caps{
+                    static_cast<pl_fmt_caps>(PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_LINEAR)};
+                group->base_fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 16, 16, base_caps);
+                if (!group->base_fmt)
+                    group->base_fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 4, 16, 16, base_caps);
+                if (!group->base_fmt)
+                    return avs_new_value_error("libplacebo_Render: couldn't find ladder base format.");
+
+                group->src_crop = src_frame.crop;
+                group->dst_color = dst_frame.color;
+                group->field = params->field;
+                group->configured = true;
+            }
+            else
+            {
+                const auto& c{group->src_crop};
+                const auto& crop{src_frame.crop};
+                if (c.x0 != crop.x0 || c.y0 != crop.y0 || c.x1 != crop.x1 || c.y1 != crop.y1 || group->field != params->field ||
+                    !pl_color_space_equal(&group->dst_color, &dst_frame.color))
+                    return avs_err_val(env, std::format("libplacebo_Render: all instances of ladder '{}' must use the same source "
+                                                        "cropping, destination color space and deinterlacing.",
+                                                *ladder));
+            }
+        }
+
+        auto& rung{params->ladder};
+        rung = std::make_unique<ladder_rung>();
+        rung->group = group;
+        rung->rr.reset(pl_renderer_create(params->vf->log.get(), gpu));
+        if (!rung->rr)
+            return avs_new_value_error("libplacebo_Render: cannot create ladder renderer.");
+
+        // Everything except scaling, dithering and the output geometry runs once in the shared pass.
+        rung->base_data = std::make_unique<pl_render_params>(*render_data);
+        auto& base_data{rung->base_data};
+        base_data->dither_params = nullptr;
+        base_data->error_diffusion = nullptr;
+        // The rung's own scaling options can differ; the base is only resampled for a fractional source crop.
+        base_data->upscaler = nullptr;
+        base_data->downscaler = nullptr;
+        base_data->sigmoid_params = nullptr;
+        base_data->disable_linear_scaling = true;
+        base_data->background_transparency = 0.0f;
+        base_data->corner_rounding = 0.0f;
+
+        rung->rung_data = std::make_unique<pl_render_params>(*render_data);
+        auto& rung_data{rung->rung_data};
+        rung_data->deband_params = nullptr;
+        rung_data->deinterlace_params = nullptr;
+        rung_data->color_adjustment = nullptr;
+        rung_data->peak_detect_params = nullptr;
+        rung_data->color_map_params = nullptr;
+        rung_data->lut = nullptr;
+        rung_data->hooks = nullptr;
+        rung_data->num_hooks = 0;
+    }
+
+    // --- Luma-only source ---
+    {
+        const auto& crop{src_frame.crop};
+        const bool is_scaled{std::abs(crop.x1 - crop.x0) != static_cast<float>(vi.width) ||
+                             std::abs(crop.y1 - crop.y0) != static_cast<float>(vi.height)};
+        const pl_color_adjustment* adj{render_data->color_adjustment};
+        const pl_color_map_params* cmap{render_data->color_map_params};
+        // The intermediate RGB passes must not clamp; without float16 FBOs libplacebo falls back to 16-bit UNORM.
+        const bool float_fbos{render_data->disable_fbos ||
+                              (!render_data->force_low_bit_depth_fbos &&
+                                  pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 16, 0, PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_RENDERABLE))};
+
+        // Everything that works on RGB other than the (linear) YCbCr conversion mixes chroma into the output luma; scaling
+        // qualifies too since antiringing and the polar/sigmoid paths clamp per channel.
+        if (params->dst_num_planes == 1 && !dst_packed_rgb && !is_src_rgb && params->src_num_planes > 1 && !group && !is_scaled &&
+            float_fbos && params->crop_keys[0].empty() && params->overlays.empty() && !render_data->lut && !render_data->num_hooks &&
+            !render_data->cone_params && (!adj || (adj->gamma == 1.0f && adj->temperature == 0.0f)) &&
+            (!cmap || (!cmap->visualize_lut && !cmap->show_clipping)) &&
+            (params->src_fmt_type == PL_FMT_FLOAT || params->src_comp_size < 4))
+        {
+            auto luma_only{std::make_unique<neutral_chroma>()};
+            luma_only->gpu = gpu;
+            luma_only->source_plane = src_frame.planes[1];
+            luma_only->num_planes = src_frame.num_planes;
+
+            std::array<std::byte, 8> texel{};
+            const auto fill{[&](auto v) {
+                std::memcpy(texel.data(), &v, sizeof(v));
+                std::memcpy(texel.data() + sizeof(v), &v, sizeof(v));
+                return static_cast<int>(sizeof(v));
+            }};
+            const int size{(params->src_fmt_type == PL_FMT_FLOAT) ? fill(0.5f)
+                           : (params->src_comp_size == 2)          ? fill(static_cast<uint16_t>(1 << (src_bit_depth - 1)))
+                                                                   : fill(static_cast<uint8_t>(1 << (src_bit_depth - 1)))};
+
+            const pl_plane_data data{
+                .type = params->src_fmt_type,
+                .width = 1,
+                .height = 1,
+                .component_size = {size * 8, size * 8},
+                .component_map = {1, 2},
+                .pixel_stride = static_cast<size_t>(size) * 2,
+                .pixels = texel.data(),
+            };
+
+            // Without a suitable format the chroma planes are simply uploaded.
+            if (pl_upload_plane(gpu, &luma_only->plane, &luma_only->tex, &data))
+                params->luma_only = std::move(luma_only);
+        }
+    }
+
+    // --- Dither LUT ---
+    if (render_data->dither_params && !render_data->error_diffusion)
+    {
+        std::unique_lock<std::mutex> lock;
+        if (group)
+            lock = std::unique_lock(group->mtx);
+
+        warm_dither_cache(*params->vf, *render_data->dither_params);
+    }
+
+    // --- Scene analysis ---
+    if (opts.get<bool>(get_param_idx<"scene_detect">()).value_or(false))
+    {
+        auto scene{std::make_unique<scene_analysis>()};
+        scene->gpu = gpu;
+        const auto [plane, channel]{luma_channel(src_frame, is_src_rgb)};
+        scene->plane = plane;
+        if (channel)
+            scene->swizzle = std::format("color = vec4(color.{});", "rgba"[channel]);
+        scene->num_frames = g_avs_api->avs_get_video_info(fi->child)->num_frames;
+        scene->threshold = 0.1f;
+        if (!update_param(opts.get<float>(get_param_idx<"scene_threshold">()), scene->threshold, "scene_threshold", msg, 0.0f, 1.0f))
+            return avs_err_val(env, msg);
+
+        const auto& bits{src_frame.repr.bits};
+        const double sample_max{static_cast<double>((1ull << bits.sample_depth) - 1)};
+        const double color_max{static_cast<double>((1ull << bits.color_depth) - 1)};
+        scene->luma_scale = (params->src_fmt_type == PL_FMT_FLOAT) ? 1.0f : static_cast<float>(sample_max / color_max);
+
+        static constexpr pl_fmt_caps scene_caps{
+            static_cast<pl_fmt_caps>(PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_LINEAR | PL_FMT_CAP_HOST_READABLE)};
+        pl_fmt scene_fmt{pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 32, 32, scene_caps)};
+        if (!scene_fmt)
+            scene_fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 1, 16, 16, scene_caps);
+        if (!scene_fmt)
+            return avs_new_value_error("libplacebo_Render: couldn't find scene analysis format.");
+
+        const auto create_tex{[&](int w, int h) {
+            const pl_tex_params t{
+                .w = w,
+                .h = h,
+                .format = scene_fmt,
+                .sampleable = true,
+                .renderable = true,
+                .host_readable = true,
+            };
+            return pl_tex_create(gpu, &t);
+        }};
+
+        // Thumbnails of at most 64x64, e.g. 60x34 for 1920x1080.
+        static constexpr int thumb_size{64};
+        int w{src_w};
+        int h{src_h};
+        while (w > thumb_size || h > thumb_size)
+        {
+            w = (w + 1) / 2;
+            h = (h + 1) / 2;
+            if (w > thumb_size || h > thumb_size)
+            {
+                if (!scene->downscale.emplace_back(create_tex(w, h)))
+                    return avs_new_value_error("libplacebo_Render: cannot allocate scene analysis texture.");
+            }
+        }
+
+        for (auto& entry : scene->thumbs)
+        {
+            entry.tex = create_tex(w, h);
+            if (!entry.tex)
+                return avs_new_value_error("libplacebo_Render: cannot allocate scene analysis texture.");
+        }
+
+        while (true)
+        {
+            if (!scene->reduce.emplace_back(create_tex(w, h)))
+                return avs_new_value_error("libplacebo_Render: cannot allocate scene analysis texture.");
+            if (w == 1 && h == 1)
+                break;
+
+            w = (w + 1) / 2;
+            h = (h + 1) / 2;
+        }
+
+        params->scene = std::move(scene);
+    }
+
+    // --- Autocrop ---
+    if (opts.get<bool>(get_param_idx<"autocrop">()).value_or(false))
+    {
+        auto autocrop{std::make_unique<autocrop_analysis>()};
+        autocrop->gpu = gpu;
+        const auto [plane, channel]{luma_channel(src_frame, is_src_rgb)};
+        autocrop->plane = plane;
+        autocrop->rows_body = std::format("int y = int(gl_FragCoord.y); int w = textureSize(luma, 0).x; float s = 0.0;"
+                                          "for (int x = 0; x < w; ++x) s += texelFetch(luma, ivec2(x, y), 0).{};"
+                                          "color = vec4(s / float(w));",
+            "rgba"[channel]);
+        autocrop->cols_body = std::format("int x = int(gl_FragCoord.x); int h = textureSize(luma, 0).y; float s = 0.0;"
+                                          "for (int y = 0; y < h; ++y) s += texelFetch(luma, ivec2(x, y), 0).{};"
+                                          "color = vec4(s / float(h));",
+            "rgba"[channel]);
+        autocrop->flipped = is_src_rgb && !avs_is_planar(&src_vi);
+        autocrop->threshold = 0.03f;
+        if (!update_param(opts.get<float>(get_param_idx<"autocrop_threshold">()), autocrop->threshold,
+                "autocrop_threshold", msg, 0.0f, 1.0f))
+            return avs_err_val(env, msg);
+
+        const auto& bits{src_frame.repr.bits};
+        const double sample_max{static_cast<double>((1ull << bits.sample_depth) - 1)};
+        const double color_max{static_cast<double>((1ull << bits.color_depth) - 1)};
+        autocrop->luma_scale = (params->src_fmt_type == PL_FMT_FLOAT) ? 1.0f : static_cast<float>(sample_max / color_max);
+
+        // Row/column indices up to 16384 need 32-bit float.
+        static constexpr pl_fmt_caps profile_caps{static_cast<pl_fmt_caps>(PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_RENDERABLE)};
+        static constexpr pl_fmt_caps bounds_caps{static_cast<pl_fmt_caps>(PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_HOST_READABLE)};
+        const pl_fmt profile_fmt{pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 32, 32, profile_caps)};
+        const pl_fmt bounds_fmt{pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 32, 32, bounds_caps)};
+        if (!profile_fmt || !bounds_fmt)
+            return avs_new_value_error("libplacebo_Render: autocrop requires renderable 32-bit float formats.");
+
+        const auto create_tex{[&](int w, int h, pl_fmt fmt) {
+            const pl_tex_params t{
+                .w = w,
+                .h = h,
+                .format = fmt,
+                .sampleable = (fmt == profile_fmt),
+                .renderable = true,
+                .host_readable = (fmt == bounds_fmt),
+            };
+            return pl_tex_create(gpu, &t);
+        }};
+
+        autocrop->rows = create_tex(1, src_h, profile_fmt);
+        autocrop->cols = create_tex(src_w, 1, profile_fmt);
+        autocrop->bounds = create_tex(1, 1, bounds_fmt);
+        if (!autocrop->rows || !autocrop->cols || !autocrop->bounds)
+            return avs_new_value_error("libplacebo_Render: cannot allocate autocrop texture.");
+
+        params->autocrop = std::move(autocrop);
+    }
+
+    auto& tex_out{params->ladder ? params->ladder->tex_out : params->vf->tex_out};
     for (int i{0}; i < params->dst_num_planes; ++i)
     {
         const pl_tex_params t_r{
             .w = (i) ? (vi.width >> dst_sub_w) : vi.width,
             .h = (i) ? (vi.height >> dst_sub_h) : vi.height,
             .format = dst_fmt,
-            .sampleable = (dst_sample_depth == 32 || src_bit_depth == 32),
+            // YUY2 packing reads the planes back.
+            .sampleable = (dst_sample_depth == 32 || src_bit_depth == 32 || dst_yuy2),
             .renderable = true,
+            // Error diffusion writes the dithered result of every plane with a compute shader.
+            .storable = (render_data->error_diffusion != nullptr),
             .blit_dst = (is_border_color),
             .host_readable = true,
         };
-        auto& tex_out{params->vf->tex_out};
 
         if (!pl_tex_recreate(gpu, &tex_out[i], &t_r))
             return avs_new_value_error("libplacebo_Render: cannot allocate out texture.");
 
-        dst_planes[i].texture = tex_out[i];
-        dst_planes[i].components = 1;
-        dst_planes[i].component_mapping[0] = i;
+        auto& plane{dst_planes[i]};
+        plane.texture = tex_out[i];
+        if (dst_packed_rgb)
+        {
+            plane.components = dst_fmt->num_components;
+            for (int c{0}; c < dst_fmt->num_components; ++c)
+                plane.component_mapping[c] = dst_map[c];
+        }
+        else
+        {
+            plane.components = 1;
+            plane.component_mapping[0] = i;
+        }
+    }
+
+    if (dst_yuy2)
+    {
+        auto yuy2_out{std::make_unique<yuy2_target>()};
+        yuy2_out->gpu = gpu;
+
+        const pl_fmt fmt{pl_find_named_fmt(gpu, "rgba8")};
+        static constexpr pl_fmt_caps yuy2_caps{static_cast<pl_fmt_caps>(PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_HOST_READABLE)};
+        if (!fmt || (fmt->caps & yuy2_caps) != yuy2_caps)
+            return avs_new_value_error("libplacebo_Render: the device cannot render to YUY2.");
+
+        const pl_tex_params t_yuy2{
+            .w = vi.width / 2,
+            .h = vi.height,
+            .format = fmt,
+            .renderable = true,
+            .host_readable = true,
+        };
+
+        if (!pl_tex_recreate(gpu, &yuy2_out->tex, &t_yuy2))
+            return avs_new_value_error("libplacebo_Render: cannot allocate out texture.");
+
+        params->yuy2_out = std::move(yuy2_out);
+    }
+
+    // --- Output frame props ---
+    {
+        const auto resolve{[](const auto val, const auto& map) -> int64_t {
+            const auto res{map.find(val)};
+            return (res) ? *res : -1;
+        }};
+
+        params->out_range = resolve(dst_frame.repr.levels, map_libpl_avs_levels);
+        params->out_matrix = resolve(dst_frame.repr.sys, map_libpl_avs_matrix);
+        params->out_cplace = (dst_frame.repr.sys != PL_COLOR_SYSTEM_RGB) ? resolve(params->dst_cplace, map_libpl_avs_cplace) : -2;
     }
 
     AVS_Value v;
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <map>
+
+#include "trace.h"
+
+namespace
+{
+    std::atomic<uint64_t> next_tracer_id{1};
+    std::atomic<uint32_t> next_tid{1};
+
+    // Tracer ids are never reused, so a stale entry cannot match a new tracer at the same address.
+    struct tls_entry
+    {
+        uint64_t owner{};
+        void* buffer{};
+    };
+
+    thread_local tls_entry tls_last;
+    thread_local const uint32_t tls_tid{next_tid.fetch_add(1, std::memory_order_relaxed)};
+
+    // The GPU pass and transfer spans of a thread go on their own tracks.
+    constexpr uint32_t gpu_pass_tid_offset{1u << 20};
+    constexpr uint32_t gpu_transfer_tid_offset{2u << 20};
+
+    void write_escaped(std::ofstream& f, const char* s)
+    {
+        for (; *s; ++s)
+        {
+            const unsigned char c{static_cast<unsigned char>(*s)};
+            if (c == '"' || c == '\\')
+                f << '\\' << *s;
+            else if (c < 0x20)
+                f << std::format("\\u{:04x}", c);
+            else
+                f << *s;
+        }
+    }
+} // namespace
+
+std::shared_ptr<tracer> tracer::acquire(const char* path)
+{
+    static std::mutex registry_mtx;
+    static std::map<std::string, std::weak_ptr<tracer>, std::less<>> registry;
+
+    std::scoped_lock lock(registry_mtx);
+    auto& entry{registry[path]};
+    auto t{entry.lock()};
+    if (!t)
+    {
+        t = std::make_shared<tracer>(std::filesystem::path{reinterpret_cast<const char8_t*>(path)});
+        entry = t;
+    }
+    return t;
+}
+
+tracer::tracer(std::filesystem::path path) : id(next_tracer_id.fetch_add(1, std::memory_order_relaxed)), path(std::move(path))
+{
+}
+
+tracer::~tracer()
+{
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f.good())
+        return;
+
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first{true};
+    const auto sep{[&]() {
+        if (!first)
+            f << ",\n";
+        first = false;
+    }};
+
+    for (const auto& buf : buffers)
+    {
+        sep();
+        const std::string dropped{(buf->dropped) ? std::format(" ({} events dropped)", buf->dropped) : ""};
+        f << std::format(
+            R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"Thread {}{}"}}}})", buf->tid, buf->tid, dropped);
+        sep();
+        f << std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"GPU passes (thread {})"}}}})",
+            buf->tid + gpu_pass_tid_offset, buf->tid);
+        sep();
+        f << std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"GPU transfers (thread {})"}}}})",
+            buf->tid + gpu_transfer_tid_offset, buf->tid);
+
+        for (const auto& e : buf->events)
+        {
+            const uint32_t offset{
+                (e.where == track::gpu_pass) ? gpu_pass_tid_offset : (e.where == track::gpu_transfer) ? gpu_transfer_tid_offset : 0};
+            sep();
+            f << "{\"name\":\"";
+            write_escaped(f, e.name);
+            f << std::format(R"(","cat":"{}","ph":"X","pid":1,"tid":{},"ts":{},"dur":{},"args":{{"frame":{}}}}})",
+                (e.where == track::cpu) ? "cpu" : "gpu", buf->tid + offset, e.ts, e.dur, e.frame);
+        }
+    }
+
+    f << "\n]}\n";
+}
+
+int64_t tracer::now_us() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+tracer::thread_buffer& tracer::local()
+{
+    if (tls_last.owner == id)
+        return *static_cast<thread_buffer*>(tls_last.buffer);
+
+    std::scoped_lock lock(mtx);
+    thread_buffer* buf{};
+    for (const auto& b : buffers)
+    {
+        if (b->tid == tls_tid)
+        {
+            buf = b.get();
+            break;
+        }
+    }
+
+    if (!buf)
+    {
+        buffers.emplace_back(std::make_unique<thread_buffer>(tls_tid));
+        buf = buffers.back().get();
+        buf->events.reserve(4096);
+    }
+
+    tls_last = {id, buf};
+    return *buf;
+}
+
+const char* tracer::intern(thread_buffer& buf, std::string_view name)
+{
+    auto it{buf.names.find(name)};
+    if (it == buf.names.end())
+        it = buf.names.emplace(name).first;
+    return it->c_str();
+}
+
+void tracer::add(thread_buffer& buf, const event& e)
+{
+    if (buf.events.size() < max_events)
+        buf.events.push_back(e);
+    else
+        ++buf.dropped;
+}
+
+void tracer::cpu_span(const char* name, int64_t begin_us, int64_t end_us, int frame) noexcept
+{
+    try
+    {
+        add(local(), {name, begin_us, end_us - begin_us, frame, track::cpu});
+    }
+    catch (...)
+    {
+    }
+}
+
+void tracer::gpu_begin(int64_t begin_us, int frame) noexcept
+{
+    try
+    {
+        auto& buf{local()};
+        buf.gpu_cursor = std::max(buf.gpu_cursor, begin_us);
+        buf.gpu_frame = frame;
+    }
+    catch (...)
+    {
+    }
+}
+
+void tracer::gpu_pass(const char* name, uint64_t duration_ns) noexcept
+{
+    try
+    {
+        auto& buf{local()};
+        const int64_t dur{static_cast<int64_t>(duration_ns / 1000)};
+        add(buf, {intern(buf, name), buf.gpu_cursor, dur, buf.gpu_frame, track::gpu_pass});
+        buf.gpu_cursor += dur;
+    }
+    catch (...)
+    {
+    }
+}
+
+void tracer::gpu_transfer(const char* name, int64_t submit_us, uint64_t duration_ns, int frame) noexcept
+{
+    try
+    {
+        add(local(), {name, submit_us, static_cast<int64_t>(duration_ns / 1000), frame, track::gpu_transfer});
+    }
+    catch (...)
+    {
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Chrome trace-event (Perfetto) recorder.
+// Every thread appends to its own buffer without locking; the file is written when the tracer is destroyed.
+// A buffer keeps at most max_events events, the later ones are only counted. Recording never throws: an event that cannot be
+// stored is dropped.
+class tracer
+{
+public:
+    // Instances with the same path (e.g. MT instances) record into one tracer.
+    static std::shared_ptr<tracer> acquire(const char* path);
+
+    explicit tracer(std::filesystem::path path);
+    tracer(const tracer&) = delete;
+    tracer& operator=(const tracer&) = delete;
+    ~tracer();
+
+    static int64_t now_us() noexcept;
+
+    void cpu_span(const char* name, int64_t begin_us, int64_t end_us, int frame) noexcept;
+
+    // Render passes, on the GPU pass track of the calling thread. libplacebo only reports the time a pass took in an earlier
+    // execution, so the passes of a frame are laid out one after another from gpu_begin(): they show what the passes cost, not
+    // when the GPU ran them.
+    void gpu_begin(int64_t begin_us, int frame) noexcept;
+    void gpu_pass(const char* name, uint64_t duration_ns) noexcept;
+
+    // A transfer measured with a pl_timer, on the GPU transfer track: the GPU time of the transfer submitted at `submit_us`.
+    void gpu_transfer(const char* name, int64_t submit_us, uint64_t duration_ns, int frame) noexcept;
+
+private:
+    enum class track : uint8_t
+    {
+        cpu,
+        gpu_pass,
+        gpu_transfer,
+    };
+
+    struct event
+    {
+        const char* name;
+        int64_t ts;
+        int64_t dur;
+        int frame;
+        track where;
+    };
+
+    // 32 MiB of events per thread.
+    static constexpr size_t max_events{1u << 20};
+
+    struct thread_buffer
+    {
+        uint32_t tid;
+        std::vector<event> events;
+        int64_t gpu_cursor{};
+        int gpu_frame{-1};
+        uint64_t dropped{};
+        // Copies of the pass names, which only live as long as their shader.
+        std::set<std::string, std::less<>> names;
+    };
+
+    // All three can throw std::bad_alloc.
+    thread_buffer& local();
+    static const char* intern(thread_buffer& buf, std::string_view name);
+    static void add(thread_buffer& buf, const event& e);
+
+    const uint64_t id;
+    const std::filesystem::path path;
+
+    std::mutex mtx; // buffers registration
+    std::vector<std::unique_ptr<thread_buffer>> buffers;
+};
+
+class trace_scope
+{
+public:
+    trace_scope(tracer* t, const char* name, int frame) noexcept
+        : t(t), name(name), frame(frame), begin((t) ? tracer::now_us() : 0)
+    {
+    }
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+
+    ~trace_scope()
+    {
+        if (t)
+            t->cpu_span(name, begin, tracer::now_us(), frame);
+    }
+
+private:
+    tracer* t;
+    const char* name;
+    int frame;
+    int64_t begin;
+};
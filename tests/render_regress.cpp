@@ -0,0 +1,530 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "avs_c_api_loader.hpp"
+
+// Renders the cases of the synthetic corpus through AviSynth+ and compares the output with a reference.
+// Every checked frame is reduced to a grid of block means per plane, compared within a tolerance so that small differences
+// between Vulkan drivers don't fail the suite. A case with a reference script is compared with that script rendered by
+// AviSynth+ on the CPU in the same run (within --reference-tolerance); the others with their stored block means.
+// The throughput of a case is measured relative to a calibration render in the same process, so the stored baseline doesn't
+// depend on the speed of the machine.
+//
+// render_regress --plugin <path> --cases <file> --references <file> --timing <file> [--case <name>] [--tolerance <v>]
+//                [--reference-tolerance <v>] [--threshold <v>] [--update]
+//
+// Exit codes: 0 pass, 1 failure, 77 skipped (no AviSynth+ runtime, no Vulkan device or no stored reference for the case yet).
+
+namespace
+{
+    constexpr int exit_fail{1};
+    constexpr int exit_skip{77};
+
+    // Frames rendered per case: the first one warms up the renderer (shader compilation) and isn't timed.
+    constexpr int num_frames{24};
+    constexpr std::array<int, 2> checked_frames{0, num_frames - 1};
+    constexpr int grid{8};
+
+    // A fixed render all the throughputs are divided by.
+    constexpr std::string_view calibration_script{
+        R"(ColorBars(320, 180, pixel_type="YV12").Trim(0, 23).libplacebo_Render(width=640, height=360, preset="fast"))"};
+
+    struct test_case
+    {
+        std::string name;
+        std::string script;
+        std::string reference; // CPU script with the expected output, empty to use the stored block means
+    };
+
+    struct options
+    {
+        std::string plugin;
+        std::string cases;
+        std::string references;
+        std::string timing;
+        std::string only_case;
+        double tolerance{0.01};
+        double reference_tolerance{0.02};
+        double threshold{0.3};
+        bool update{};
+    };
+
+    // "<case>/<frame>/<plane>" -> block means, or "<case>" -> throughput relative to the calibration render.
+    using value_map = std::map<std::string, std::vector<double>>;
+
+    std::optional<options> parse_args(int argc, char** argv)
+    {
+        options opts;
+        for (int i{1}; i < argc; ++i)
+        {
+            const std::string_view arg{argv[i]};
+            if (arg == "--update")
+            {
+                opts.update = true;
+                continue;
+            }
+            if (i + 1 == argc)
+                return std::nullopt;
+
+            const char* value{argv[++i]};
+            if (arg == "--plugin")
+                opts.plugin = value;
+            else if (arg == "--cases")
+                opts.cases = value;
+            else if (arg == "--references")
+                opts.references = value;
+            else if (arg == "--timing")
+                opts.timing = value;
+            else if (arg == "--case")
+                opts.only_case = value;
+            else if (arg == "--tolerance")
+                opts.tolerance = std::stod(value);
+            else if (arg == "--reference-tolerance")
+                opts.reference_tolerance = std::stod(value);
+            else if (arg == "--threshold")
+                opts.threshold = std::stod(value);
+            else
+                return std::nullopt;
+        }
+
+        if (opts.plugin.empty() || opts.cases.empty() || opts.references.empty() || opts.timing.empty())
+            return std::nullopt;
+
+        return opts;
+    }
+
+    // One case per line, "name: script", optionally followed by an indented "reference: script" line.
+    // Empty lines and lines starting with '#' are ignored.
+    std::vector<test_case> load_cases(const std::string& path)
+    {
+        std::vector<test_case> cases;
+        std::ifstream f(path);
+        for (std::string line; std::getline(f, line);)
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            const size_t key_start{line.find_first_not_of(' ')};
+            const size_t colon{line.find(':')};
+            if (key_start == std::string::npos || colon == std::string::npos || colon < key_start)
+                continue;
+
+            const std::string key{line.substr(key_start, colon - key_start)};
+            const size_t script_start{line.find_first_not_of(' ', colon + 1)};
+            std::string script{(script_start == std::string::npos) ? "" : line.substr(script_start)};
+
+            if (key_start == 0)
+                cases.push_back({key, std::move(script), {}});
+            else if (key == "reference" && !cases.empty())
+                cases.back().reference = std::move(script);
+        }
+
+        return cases;
+    }
+
+    value_map load_values(const std::string& path)
+    {
+        value_map values;
+        std::ifstream f(path);
+        for (std::string line; std::getline(f, line);)
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream s(line);
+            std::string key;
+            s >> key;
+            auto& v{values[key]};
+            for (double d; s >> d;)
+                v.push_back(d);
+        }
+
+        return values;
+    }
+
+    bool save_values(const std::string& path, const value_map& values, std::string_view header)
+    {
+        std::ofstream f(path, std::ios::trunc);
+        f << "# " << header << '\n';
+        for (const auto& [key, v] : values)
+        {
+            f << key;
+            for (double d : v)
+                f << std::format(" {:.6f}", d);
+            f << '\n';
+        }
+
+        return f.good();
+    }
+
+    std::vector<int> frame_planes(const AVS_VideoInfo* vi)
+    {
+        if (!avs_is_planar(vi))
+            return {AVS_DEFAULT_PLANE};
+
+        static constexpr std::array yuv{AVS_PLANAR_Y, AVS_PLANAR_U, AVS_PLANAR_V, AVS_PLANAR_A};
+        static constexpr std::array rgb{AVS_PLANAR_G, AVS_PLANAR_B, AVS_PLANAR_R, AVS_PLANAR_A};
+        const auto& planes{(avs_is_rgb(vi)) ? rgb : yuv};
+        return {planes.begin(), planes.begin() + g_avs_api->avs_num_components(vi)};
+    }
+
+    // Means of grid x grid blocks of the plane, normalized to [0, 1] (float samples as they are).
+    std::vector<double> block_means(AVS_VideoFrame* frame, int plane, const AVS_VideoInfo* vi)
+    {
+        const int comp_size{g_avs_api->avs_component_size(vi)};
+        const int bits{g_avs_api->avs_bits_per_component(vi)};
+        const double scale{(comp_size == 4) ? 1.0 : 1.0 / ((1 << bits) - 1)};
+
+        const uint8_t* ptr{g_avs_api->avs_get_read_ptr_p(frame, plane)};
+        const int pitch{g_avs_api->avs_get_pitch_p(frame, plane)};
+        const int w{g_avs_api->avs_get_row_size_p(frame, plane) / comp_size};
+        const int h{g_avs_api->avs_get_height_p(frame, plane)};
+
+        std::vector<double> sums(grid * grid);
+        std::vector<int> counts(grid * grid);
+        for (int y{0}; y < h; ++y)
+        {
+            const uint8_t* row{ptr + static_cast<ptrdiff_t>(y) * pitch};
+            for (int x{0}; x < w; ++x)
+            {
+                double v;
+                if (comp_size == 1)
+                    v = row[x];
+                else if (comp_size == 2)
+                {
+                    uint16_t s;
+                    std::memcpy(&s, row + x * 2, sizeof(s));
+                    v = s;
+                }
+                else
+                {
+                    float s;
+                    std::memcpy(&s, row + x * 4, sizeof(s));
+                    v = s;
+                }
+
+                const int block{(y * grid / h) * grid + x * grid / w};
+                sums[block] += v * scale;
+                ++counts[block];
+            }
+        }
+
+        for (size_t i{0}; i < sums.size(); ++i)
+            sums[i] = (counts[i]) ? sums[i] / counts[i] : 0.0;
+
+        return sums;
+    }
+
+    class avs_runtime
+    {
+    public:
+        ~avs_runtime()
+        {
+            if (env)
+                g_avs_api->avs_delete_script_environment(env);
+#ifdef _WIN32
+            if (lib)
+                FreeLibrary(static_cast<HMODULE>(lib));
+#else
+            if (lib)
+                dlclose(lib);
+#endif
+        }
+
+        // Loads the AviSynth+ library and the plugin. Returns an error message on failure.
+        std::optional<std::string> init(const std::string& plugin)
+        {
+#ifdef _WIN32
+            lib = LoadLibraryW(L"AviSynth.dll");
+            const auto create{(lib) ? reinterpret_cast<AVS_ScriptEnvironment*(AVSC_CC*)(int)>(
+                                          GetProcAddress(static_cast<HMODULE>(lib), "avs_create_script_environment"))
+                                    : nullptr};
+#else
+#ifdef __APPLE__
+            lib = dlopen("libavisynth.dylib", RTLD_NOW | RTLD_GLOBAL);
+#else
+            lib = dlopen("libavisynth.so", RTLD_NOW | RTLD_GLOBAL);
+#endif
+            const auto create{
+                (lib) ? reinterpret_cast<AVS_ScriptEnvironment* (*)(int)>(dlsym(lib, "avs_create_script_environment")) : nullptr};
+#endif
+            if (!create)
+                return "cannot load the AviSynth+ library.";
+
+            env = create(AVS_INTERFACE_VERSION);
+            if (!env)
+                return "cannot create an AviSynth+ script environment.";
+
+            static constexpr std::string_view required_functions[]{
+                "avs_invoke",
+                "avs_take_clip",
+                "avs_release_clip",
+                "avs_release_value",
+                "avs_release_video_frame",
+                "avs_get_video_info",
+                "avs_get_frame",
+                "avs_get_read_ptr_p",
+                "avs_get_pitch_p",
+                "avs_get_row_size_p",
+                "avs_get_height_p",
+                "avs_num_components",
+                "avs_component_size",
+                "avs_bits_per_component",
+                "avs_delete_script_environment",
+            };
+            if (!avisynth_c_api_loader::get_api(env, 9, 2, std::span<const std::string_view>{required_functions}))
+                return avisynth_c_api_loader::get_last_error();
+
+            const avs_helpers::avs_value_guard res{invoke("LoadPlugin", plugin)};
+            if (avs_is_error(res.get()))
+                return avs_as_error(res.get());
+
+            return std::nullopt;
+        }
+
+        AVS_Value invoke(const char* name, const std::string& arg)
+        {
+            return g_avs_api->avs_invoke(env, name, avs_new_value_string(arg.c_str()), nullptr);
+        }
+
+        AVS_ScriptEnvironment* get() const noexcept
+        {
+            return env;
+        }
+
+    private:
+        void* lib{};
+        AVS_ScriptEnvironment* env{};
+    };
+
+    // Renders the script, fills the block means of its checked frames under "<name>/<frame>/<plane>" and its frames per second.
+    // With `expected_vi`, the clip must have the same format and size.
+    std::optional<std::string> render_script(avs_runtime& avs, std::string_view name, std::string_view script, value_map& means,
+        double& fps, const AVS_VideoInfo* expected_vi = nullptr, AVS_VideoInfo* out_vi = nullptr)
+    {
+        const avs_helpers::avs_value_guard res{avs.invoke("Eval", std::string{script})};
+        if (avs_is_error(res.get()))
+            return avs_as_error(res.get());
+        if (!avs_is_clip(res.get()))
+            return "the script doesn't return a clip.";
+
+        const avs_helpers::avs_clip_ptr clip{g_avs_api->avs_take_clip(res.get(), avs.get())};
+        const AVS_VideoInfo* vi{g_avs_api->avs_get_video_info(clip.get())};
+        if (vi->num_frames < num_frames)
+            return std::format("the clip must have at least {} frames.", num_frames);
+        if (expected_vi && (vi->pixel_type != expected_vi->pixel_type || vi->width != expected_vi->width ||
+                               vi->height != expected_vi->height))
+            return "the reference clip has a different format or size.";
+        if (out_vi)
+            *out_vi = *vi;
+
+        const auto planes{frame_planes(vi)};
+        const auto check{[&](AVS_VideoFrame* frame, int n) {
+            for (size_t p{0}; p < planes.size(); ++p)
+                means[std::format("{}/{}/{}", name, n, p)] = block_means(frame, planes[p], vi);
+        }};
+
+        {
+            const avs_helpers::avs_video_frame_ptr frame{g_avs_api->avs_get_frame(clip.get(), 0)};
+            if (!frame)
+                return "cannot get frame 0.";
+            check(frame.get(), 0);
+        }
+
+        const auto begin{std::chrono::steady_clock::now()};
+        for (int n{1}; n < num_frames; ++n)
+        {
+            const avs_helpers::avs_video_frame_ptr frame{g_avs_api->avs_get_frame(clip.get(), n)};
+            if (!frame)
+                return std::format("cannot get frame {}.", n);
+            if (std::ranges::find(checked_frames, n) != checked_frames.end())
+                check(frame.get(), n);
+        }
+        const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - begin};
+        fps = (num_frames - 1) / elapsed.count();
+
+        return std::nullopt;
+    }
+
+    // Compares the block means with `references`, whose keys are the same with the case name in place of `ref_name`.
+    // Returns false on a failure; `skipped` is set if a reference is missing.
+    bool compare_means(const test_case& c, const value_map& means, const value_map& references, std::string_view ref_name,
+        double tolerance, bool& skipped)
+    {
+        bool ok{true};
+        for (const auto& [key, v] : means)
+        {
+            const auto ref{references.find(std::string{ref_name} + key.substr(c.name.size()))};
+            if (ref == references.end())
+            {
+                std::cout << std::format("{}: no reference for {}; run the update_test_references target\n", c.name, key);
+                skipped = true;
+                continue;
+            }
+
+            for (size_t i{0}; i < v.size(); ++i)
+            {
+                const double diff{(i < ref->second.size()) ? std::abs(v[i] - ref->second[i]) : INFINITY};
+                if (diff > tolerance)
+                {
+                    std::cout << std::format("{}: FAIL: {} block {} differs by {:.6f} (tolerance {})\n", c.name, key, i, diff, tolerance);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+
+        return ok;
+    }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const auto opts{parse_args(argc, argv)};
+    if (!opts)
+    {
+        std::cerr << "usage: render_regress --plugin <path> --cases <file> --references <file> --timing <file> [--case <name>] "
+                     "[--tolerance <v>] [--reference-tolerance <v>] [--threshold <v>] [--update]\n";
+        return exit_fail;
+    }
+
+    auto cases{load_cases(opts->cases)};
+    if (!opts->only_case.empty())
+        std::erase_if(cases, [&](const test_case& c) { return c.name != opts->only_case; });
+    if (cases.empty())
+    {
+        std::cerr << "no matching case in " << opts->cases << '\n';
+        return exit_fail;
+    }
+
+    avs_runtime avs;
+    if (const auto err{avs.init(opts->plugin)})
+    {
+        std::cout << "skipped: " << *err << '\n';
+        return exit_skip;
+    }
+
+    // Without a usable Vulkan device (e.g. lavapipe) there is nothing to test.
+    {
+        const avs_helpers::avs_value_guard probe{
+            avs.invoke("Eval", "libplacebo_Render(BlankClip(pixel_type=\"YV12\"), list_devices=true)")};
+        if (avs_is_error(probe.get()))
+        {
+            std::cout << "skipped: no Vulkan device: " << avs_as_error(probe.get()) << '\n';
+            return exit_skip;
+        }
+    }
+
+    double calibration_fps{};
+    {
+        value_map unused;
+        if (const auto err{render_script(avs, "calibration", calibration_script, unused, calibration_fps)})
+        {
+            std::cout << std::format("FAIL: calibration render: {}\n", *err);
+            return exit_fail;
+        }
+    }
+
+    value_map references{load_values(opts->references)};
+    value_map timing{load_values(opts->timing)};
+    bool failed{};
+    bool skipped{};
+
+    for (const auto& c : cases)
+    {
+        value_map means;
+        double fps{};
+        AVS_VideoInfo vi{};
+        if (const auto err{render_script(avs, c.name, c.script, means, fps, nullptr, &vi)})
+        {
+            std::cout << std::format("{}: FAIL: {}\n", c.name, *err);
+            failed = true;
+            continue;
+        }
+
+        const double speed{fps / calibration_fps};
+
+        // The reference script is rendered in every run, also in update mode to report a broken one.
+        value_map cpu_means;
+        if (!c.reference.empty())
+        {
+            double unused{};
+            if (const auto err{render_script(avs, "reference", c.reference, cpu_means, unused, &vi)})
+            {
+                std::cout << std::format("{}: FAIL: reference script: {}\n", c.name, *err);
+                failed = true;
+                continue;
+            }
+        }
+
+        if (opts->update)
+        {
+            // Only the cases without a reference script have stored block means.
+            if (c.reference.empty())
+            {
+                for (auto& [key, v] : means)
+                    references[key] = std::move(v);
+            }
+            timing[c.name] = {speed};
+            std::cout << std::format("{}: updated ({:.2f} fps, {:.3f}x the calibration render)\n", c.name, fps, speed);
+            continue;
+        }
+
+        bool case_failed{};
+        if (c.reference.empty())
+            case_failed = !compare_means(c, means, references, c.name, opts->tolerance, skipped);
+        else
+            case_failed = !compare_means(c, means, cpu_means, "reference", opts->reference_tolerance, skipped);
+
+        if (const auto base{timing.find(c.name)}; base != timing.end() && !base->second.empty())
+        {
+            const double min_speed{base->second[0] * (1.0 - opts->threshold)};
+            std::cout << std::format(
+                "{}: {:.2f} fps, {:.3f}x the calibration render (baseline {:.3f}x)\n", c.name, fps, speed, base->second[0]);
+            if (speed < min_speed)
+            {
+                std::cout << std::format("{}: FAIL: throughput below {:.3f}x the calibration render\n", c.name, min_speed);
+                case_failed = true;
+            }
+        }
+        else
+        {
+            std::cout << std::format("{}: {:.2f} fps, {:.3f}x the calibration render (no baseline)\n", c.name, fps, speed);
+        }
+
+        failed |= case_failed;
+    }
+
+    if (opts->update)
+    {
+        if (!save_values(opts->references, references, "<case>/<frame>/<plane> block means") ||
+            !save_values(opts->timing, timing, "<case> throughput relative to the calibration render"))
+        {
+            std::cerr << "cannot write the references.\n";
+            return exit_fail;
+        }
+    }
+
+    if (failed)
+        return exit_fail;
+
+    return (skipped) ? exit_skip : 0;
+}